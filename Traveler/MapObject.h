@@ -1,12 +1,40 @@
 #ifndef MAPOBJECT_H
 #define MAPOBJECT_H
 
+#include "mapcache.h"
+#include "mapfile.h"
+#include "mapjournal.h"
 #include "mappoint.h"
 #include "mapregion.h"
+#include "pointindex.h"
+#include "regionindex.h"
+#include "slotmap.h"
+#include "trace.h"
 
-#include <QDomDocument>
-#include <QFile>
-#include <QTextStream>
+#include <QHash>
+#include <QSet>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+
+using PointHandle = SlotMap<MapPoint>::Handle;
+
+struct MapStats {
+    uint regionsTotal = 0;
+    uint regionsVisited = 0; // Also through their detail maps
+    uint pointsVisited = 0;
+
+    bool operator==(const MapStats& right) const {
+        return regionsTotal == right.regionsTotal &&
+            regionsVisited == right.regionsVisited &&
+            pointsVisited == right.pointsVisited;
+    }
+
+    bool operator!=(const MapStats& right) const {
+        return !(*this == right);
+    }
+};
 
 class MapObject {
 public:
@@ -15,6 +43,17 @@ public:
         load(filename);
     }
 
+    // False if the file couldn't be read as a map, the map is then empty
+    // and never stored
+    bool isValid() const {
+        return m_valid;
+    }
+
+    // File the map was loaded from or last compacted into
+    const QString& getFilename() const {
+        return m_filename;
+    }
+
     QSize getSize() const {
         return QSize(m_width, m_height);
     }
@@ -28,362 +67,524 @@ public:
     }
 
     MapRegion* getRegion(QPointF point) {
-        MapRegion* result = nullptr;
-        for (auto& region : m_region_list) {
-            for (auto& polygon : region.getPolygonList()) {
-                if (polygon.containsPoint(point, Qt::OddEvenFill)) {
-                    result = &region;
-                    break;
-                }
-            }
+        int id = m_region_index.find(m_region_list, point);
+        if (id < 0) {
+            return nullptr;
         }
-        return result;
+        return &m_region_list[id];
     }
 
-    const QVector<MapPoint>& getPointList() const {
-        return m_point_list;
+    // Regions may share a name, e.g. parts of a country
+    QVector<MapRegion*> findRegions(const QString& name) {
+        QVector<MapRegion*> region_list;
+        for (MapRegion& region : m_region_list) {
+            if (region.getName().compare(name, Qt::CaseInsensitive) == 0) {
+                region_list.push_back(&region);
+            }
+        }
+        return region_list;
     }
 
-    MapPoint* getPoint(QPointF point) {
-        MapPoint* result = nullptr;
-        for (auto& p : m_point_list) {
-            float dx = p.getPoint().x() - point.x();
-            float dy = p.getPoint().y() - point.y();
-            if (dx * dx + dy * dy <= m_pointRadius * m_pointRadius) {
-                result = &p;
-                break;
+    // Regions linking to a detail map
+    QVector<MapRegion*> getLinkedRegions() {
+        QVector<MapRegion*> region_list;
+        for (MapRegion& region : m_region_list) {
+            if (!region.getChildMap().isEmpty()) {
+                region_list.push_back(&region);
             }
         }
-        return result;
+        return region_list;
     }
 
-    void store(const QString& filename) const {
-        Q_ASSERT(!filename.isEmpty());
-
-        QFile file(filename);
-        bool ok = file.open(QFile::WriteOnly | QFile::Text);
-        Q_ASSERT(ok);
+    // Points in the order they are saved in, removal moves the last point
+    // in place of the removed one
+    const QVector<MapPoint>& getPointList() const {
+        return m_points.getValues();
+    }
 
-        QTextStream stream(&file);
-        stream << m_doc.toString();
-        file.close();
+    // Returns the nearest point within the point radius, or a null handle
+    PointHandle findPoint(QPointF point) const {
+        int id = m_point_index.findNearest(
+            m_points.getValues(), point, m_pointRadius);
+        if (id < 0) {
+            return PointHandle();
+        }
+        return m_points.getHandle(id);
     }
 
-    MapPoint* addPoint(QPointF point, const QString& name) {
-        QDomElement element = m_doc.createElement("circle");
-        element.setAttribute("cx", point.x());
-        element.setAttribute("cy", point.y());
-        element.setAttribute("r", m_pointRadius);
+    // Returns nullptr for a stale handle
+    MapPoint* getPoint(PointHandle handle) {
+        return m_points.get(handle);
+    }
 
-        QDomElement title_element = m_doc.createElement("title");
-        QDomText title_text = m_doc.createTextNode(name);
-        title_element.appendChild(title_text);
-        element.appendChild(title_element);
-        m_points_group.appendChild(element);
+    const MapPoint* getPoint(PointHandle handle) const {
+        return m_points.get(handle);
+    }
 
-        m_point_list.emplace_back(
-            m_doc, m_points_group, element, point, name);
-        return &m_point_list.back();
+    // Position of the point in the point list, or -1 for a stale handle
+    int getPointIndex(PointHandle handle) const {
+        return m_points.indexOf(handle);
     }
 
-    void removePoint(MapPoint* point) {
-        Q_ASSERT(point != nullptr);
+    // Saving to the loaded file appends the changes made since the last
+    // save to its journal. Saving to another file, or once the journal
+    // has grown long, compacts everything into the svg instead. Returns
+    // false if the changes couldn't be written.
+    bool store(const QString& filename) {
+        Q_ASSERT(!filename.isEmpty());
+        TRACE_SCOPE("MapObject::store");
+        if (!m_valid) {
+            return false;
+        }
 
-        point->remove();
-        bool ok = m_point_list.removeOne(*point);
-        Q_ASSERT(ok);
-    }
+        if (filename != m_filename) {
+            return compact(filename);
+        }
 
-    void getStats(
-            uint& regionsTotal,
-            uint& regionsVisited,
-            uint& pointsVisited) const {
-        regionsVisited = 0;
-        for (auto& region : m_region_list) {
-            if (region.isVisited()) {
-                ++regionsVisited;
-            }
+        QList<QByteArray> entry_list = getChanges();
+        if (entry_list.isEmpty()) {
+            return true;
         }
 
-        regionsTotal = m_region_list.size();
-        pointsVisited = m_point_list.size();
+        if (!MapJournal::append(m_filename, m_hash, entry_list)) {
+            return compact(filename);
+        }
+        m_journalSize += entry_list.size();
+        updateSnapshot();
+
+        // The changes are safe in the journal even if this fails
+        if (m_journalSize >= MAX_JOURNAL_SIZE) {
+            compact(filename);
+        }
+        return true;
     }
 
-private:
-    static float getValue(const QString& path, uint& start) {
-        Q_ASSERT(!path.isEmpty());
-        Q_ASSERT(start < path.size());
-
-        uint i = start;
-        QChar c = path[i];
-        while (c.isSpace()) {
-            ++i;
-            Q_ASSERT(i < path.size());
-            c = path[i];
-        }
-
-        QString x = "";
-        if (c == '-') {
-            x.push_back(c);
-            ++i;
-            Q_ASSERT(i < path.size());
-            c = path[i];
-        }
-        while (c.isDigit() || c == '.') {
-            x.push_back(c);
-            ++i;
-            Q_ASSERT(i < path.size());
-            c = path[i];
-        }
-        if (c == 'e') {
-            x.push_back(c);
-            ++i;
-            Q_ASSERT(i < path.size());
-            c = path[i];
-
-            if (c == '-') {
-                x.push_back(c);
-                ++i;
-                Q_ASSERT(i < path.size());
-                c = path[i];
-            }
-            while (c.isDigit()) {
-                x.push_back(c);
-                ++i;
-                Q_ASSERT(i < path.size());
-                c = path[i];
-            }
+    // Writes the whole model into the svg through a temporary file,
+    // after which the journal is no longer needed. Returns false if the
+    // svg couldn't be written.
+    bool compact(const QString& filename) {
+        if (!m_valid) {
+            return false;
         }
 
-        bool ok = false;
-        x.toFloat(&ok);
-        Q_ASSERT(ok);
+        bool ok = MapFile::store(
+            m_filename, filename, m_pointRadius,
+            m_region_list, m_points.getValues());
+        if (!ok) {
+            return false;
+        }
 
-        start = i;
-        return x.toFloat();
-    }
+        MapJournal::remove(filename);
+        m_filename = filename;
+        m_hash = MapCache::hashFile(m_filename);
+        m_journalSize = 0;
 
-    static QPointF getPoint(const QString& path, uint& start) {
-        Q_ASSERT(!path.isEmpty());
-        Q_ASSERT(start < path.size());
+        // Ids follow the order in which the points were written
+        resetPointIds();
+        takeSnapshot();
 
-        float x = 0, y = 0;
+        MapCache::write(
+            m_filename, m_hash, m_width, m_height,
+            m_region_list, m_points.getValues());
+        return true;
+    }
 
-        x = getValue(path, start);
+    PointHandle addPoint(QPointF point, const QString& name) {
+        MapPoint value(point, name);
+        int id = m_nextPointId++;
+        value.setId(id);
+        m_point_index.insert(m_points.size(), point);
+        PointHandle handle = m_points.insert(std::move(value));
+        m_dirty_point_list.insert(id, handle);
+        return handle;
+    }
 
-        QChar c = path[start];
-        Q_ASSERT(c.isSpace() || c == '-');
-        while (c.isSpace()) {
-            ++start;
-            Q_ASSERT(start < path.size());
-            c = path[start];
+    // Adds the points lying on regions, skipping the ones that duplicate
+    // an existing or earlier point at stored precision. Returns the number
+    // of added points, which are appended to the point list.
+    int addPoints(const QVector<QPair<QPointF, QString>>& point_list) {
+        QSet<quint64> key_list;
+        key_list.reserve(m_points.size() + point_list.size());
+        for (const MapPoint& point : m_points.getValues()) {
+            key_list.insert(getPointKey(point.getPoint()));
         }
+        m_points.reserve(m_points.size() + point_list.size());
+
+        int count = 0;
+        for (const auto& point : point_list) {
+            if (m_region_index.find(m_region_list, point.first) < 0) {
+                continue;
+            }
 
-        y = getValue(path, start);
+            quint64 key = getPointKey(point.first);
+            if (key_list.contains(key)) {
+                continue;
+            }
+            key_list.insert(key);
 
-        return QPointF(x, y);
+            addPoint(point.first, point.second);
+            ++count;
+        }
+        return count;
     }
 
-    static QPolygonF getPolygon(const QString& path, QPointF& base) {
-        Q_ASSERT(!path.isEmpty());
-        Q_ASSERT(path[0] == 'm' || path[0] == 'M');
+    // The last point takes the place of the removed one
+    void removePoint(PointHandle handle) {
+        int id = m_points.indexOf(handle);
+        Q_ASSERT(id >= 0);
+        if (id < 0) {
+            return;
+        }
 
-        QPolygonF polygon;
+        m_dirty_point_list.insert(m_points[id].getId(), handle);
+        m_point_index.remove(id, m_points[id].getPoint());
+        int last = m_points.size() - 1;
+        if (id != last) {
+            m_point_index.move(last, id, m_points[last].getPoint());
+        }
+        m_points.remove(handle);
+    }
 
-        uint id = 1;
-        QPointF start_point(0.0f, 0.0f);
-        if (path[0] == 'm') {
-            start_point = base;
+    void setPointName(PointHandle handle, const QString& name) {
+        MapPoint* point = m_points.get(handle);
+        Q_ASSERT(point != nullptr);
+        if (point == nullptr) {
+            return;
         }
-        start_point += getPoint(path, id);
-        polygon.push_back(start_point);
+        point->setName(name);
+        m_dirty_point_list.insert(point->getId(), handle);
+    }
 
-        if (path[0] == 'm') {
-            while (path[id].isSpace() || path[id] == '-') {
-                Q_ASSERT(id < path.size());
-                QPointF point = getPoint(path, id);
-                QPointF prev = polygon.back();
-                polygon.push_back(prev + point);
-            }
-        } else { // 'M'
-            while (path[id].isSpace() || path[id] == '-') {
-                Q_ASSERT(id < path.size());
-                QPointF point = getPoint(path, id);
-                polygon.push_back(point);
-            }
+    void setPointPhotos(PointHandle handle, const QStringList& photos) {
+        MapPoint* point = m_points.get(handle);
+        Q_ASSERT(point != nullptr);
+        if (point == nullptr) {
+            return;
         }
+        point->setPhotos(photos);
+        m_dirty_point_list.insert(point->getId(), handle);
+    }
 
-        while (id < path.size()) {
-            switch (path[id].unicode()) {
-            case u'v': {
-                ++id;
-                do {
-                    Q_ASSERT(id < path.size());
-                    float value = getValue(path, id);
-                    QPointF prev = polygon.back();
-                    polygon.push_back(QPointF(prev.x(), prev.y() + value));
-                } while (path[id].isSpace() || path[id] == '-');
-                break;
-            }
-            case u'h': {
-                ++id;
-                do {
-                    Q_ASSERT(id < path.size());
-                    float value = getValue(path, id);
-                    QPointF prev = polygon.back();
-                    polygon.push_back(QPointF(prev.x() + value, prev.y()));
-                } while (path[id].isSpace() || path[id] == '-');
-                break;
-            }
-            case u'l': {
-                ++id;
-                do {
-                    Q_ASSERT(id < path.size());
-                    QPointF point = getPoint(path, id);
-                    QPointF prev = polygon.back();
-                    polygon.push_back(prev + point);
-                } while (path[id].isSpace() || path[id] == '-');
-                break;
-            }
-            case u'z': {
-                ++id;
-                Q_ASSERT(id == path.size());
-                break;
-            }
-            default: {
-                Q_ASSERT(false);
-                break;
-            }
-            }
+    void setRegionName(MapRegion* region, const QString& name) {
+        Q_ASSERT(region != nullptr);
+        region->setName(name);
+        m_dirty_region_list.insert(getRegionId(region));
+    }
+
+    // Regions are marked visited through the map, which keeps count
+    void setVisited(MapRegion* region, bool visited) {
+        Q_ASSERT(region != nullptr);
+        if (region->isVisited() == visited) {
+            return;
         }
+        bool shown = region->isShownVisited();
+        region->setVisited(visited);
+        m_dirty_region_list.insert(getRegionId(region));
+        countVisited(shown, region->isShownVisited());
+    }
 
-        base = start_point;
-        return polygon;
+    // Not a change of the map, so it isn't saved
+    void setChildVisited(MapRegion* region, bool visited) {
+        Q_ASSERT(region != nullptr);
+        bool shown = region->isShownVisited();
+        region->setChildVisited(visited);
+        countVisited(shown, region->isShownVisited());
     }
 
-    void load(const QString& filename) {
-        Q_ASSERT(!filename.isEmpty());
+    MapStats getStats() const {
+        return {
+            uint(m_region_list.size()),
+            m_regionsVisited,
+            uint(m_points.size())
+        };
+    }
+
+private:
+    static constexpr int MAX_JOURNAL_SIZE = 1024;
 
-        QFile file(filename);
-        bool ok = file.open(QFile::ReadOnly);
-        Q_ASSERT(ok);
-        m_doc.setContent(&file);
-        file.close();
+    struct SavedRegion {
+        bool visited;
+        QString name;
+    };
 
-        QDomElement root = m_doc.documentElement();
-        Q_ASSERT(root.tagName() == "svg");
+    struct SavedPoint {
+        QString name;
+        QString photos;
+    };
 
-        QDomAttr width = root.attributeNode("width");
-        Q_ASSERT(!width.isNull());
-        m_width = width.value().toUInt();
+    void load(const QString& filename) {
+        Q_ASSERT(!filename.isEmpty());
+        TRACE_SCOPE("MapObject::load");
+
+        // The svg is hashed once, for the cache and the journal
+        m_filename = filename;
+        m_hash = MapCache::hashFile(m_filename);
+        m_valid = true;
+        QVector<MapPoint> point_list;
+        if (!MapCache::read(
+                m_filename, m_hash, m_width, m_height,
+                m_region_list, point_list)) {
+            if (!MapFile::load(
+                    m_filename, m_width, m_height,
+                    m_region_list, point_list)) {
+                m_valid = false;
+                m_region_list.clear();
+                m_width = m_height = 0;
+                m_pointRadius = 1.0f;
+                m_regionsVisited = 0;
+                m_nextPointId = 0;
+                m_journalSize = 0;
+                m_point_index.reset(m_pointRadius);
+                return;
+            }
 
-        QDomAttr height = root.attributeNode("height");
-        Q_ASSERT(!height.isNull());
-        m_height = height.value().toUInt();
+            // Levels are simplified once and kept in the cache
+            QtConcurrent::blockingMap(m_region_list, [](MapRegion& region) {
+                region.buildLevels();
+            });
+            MapCache::write(
+                m_filename, m_hash, m_width, m_height,
+                m_region_list, point_list);
+        }
 
         m_pointRadius = qMax(m_width, m_height) / 1024.0f;
 
-        // Paths
+        for (int i = 0; i < point_list.size(); ++i) {
+            point_list[i].setId(i);
+        }
+        m_nextPointId = point_list.size();
+        QVector<MapJournal::Entry> entry_list;
+        if (!MapJournal::read(m_filename, m_hash, entry_list)) {
+            // Saves appended under the old header would be lost as well
+            MapJournal::remove(m_filename);
+        }
+        for (const auto& entry : entry_list) {
+            replay(entry, point_list);
+        }
+        m_journalSize = entry_list.size();
 
-        QDomNode node = root.firstChild();
-        Q_ASSERT(!node.isNull());
+        m_points.clear();
+        m_points.reserve(point_list.size());
+        for (MapPoint& point : point_list) {
+            m_points.insert(std::move(point));
+        }
+        takeSnapshot();
 
-        QDomElement element = node.toElement();
-        auto name = element.tagName();
-        Q_ASSERT(name == "g");
+        m_regionsVisited = std::count_if(
+            m_region_list.cbegin(), m_region_list.cend(),
+            [](const MapRegion& region) {
+                return region.isVisited();
+            });
 
-        QDomNode sub_node = node.firstChild();
-        while (!sub_node.isNull()) {
-            QDomElement sub_element = sub_node.toElement();
-            auto sub_name = sub_element.tagName();
-            if (sub_name == "path") {
-                bool visited = false;
-                if (sub_element.hasAttribute("fill")) {
-                    visited = true;
-                }
+        m_region_index.build(m_region_list);
 
-                QString name("");
-                if (sub_element.hasChildNodes()) {
-                    QDomNode title_node = sub_node.firstChild();
-                    QDomElement title_element = title_node.toElement();
-                    name = title_element.text();
-                } else {
-                    if (sub_element.hasAttribute("name")) {
-                        name = sub_element.attribute("name");
-                    }
-                }
+        m_point_index.reset(2.0f * m_pointRadius);
+        for (int i = 0; i < m_points.size(); ++i) {
+            m_point_index.insert(i, m_points[i].getPoint());
+        }
+    }
 
-                MapRegion region(m_doc, sub_element, name, visited);
+    // Points are written to the svg as floats
+    static quint64 getPointKey(QPointF point) {
+        float x = point.x();
+        float y = point.y();
+        quint32 x_bits, y_bits;
+        memcpy(&x_bits, &x, sizeof(x));
+        memcpy(&y_bits, &y, sizeof(y));
+        return (quint64(x_bits) << 32) | y_bits;
+    }
 
-                QPointF base(0.0f, 0.0f);
-                auto content = sub_element.attribute("d");
-                auto path_list = content.split('z');
-                for (auto& path : path_list) {
-                    if (path.isEmpty()) {
-                        continue;
-                    }
-                    path.push_back('z');
-                    auto polygon = getPolygon(path, base);
-                    Q_ASSERT(!polygon.isEmpty());
+    void countVisited(bool before, bool after) {
+        if (after && !before) {
+            ++m_regionsVisited;
+        } else if (before && !after) {
+            --m_regionsVisited;
+        }
+    }
 
-                    region.addPolygon(polygon);
-                }
+    int getRegionId(const MapRegion* region) const {
+        int id = region - m_region_list.constData();
+        Q_ASSERT(id >= 0 && id < m_region_list.size());
+        return id;
+    }
 
-                if (!region.getPolygonList().isEmpty()) {
-                    m_region_list.push_back(region);
-                }
-            }
-            sub_node = sub_node.nextSibling();
+    void resetPointIds() {
+        for (int i = 0; i < m_points.size(); ++i) {
+            m_points[i].setId(i);
+        }
+        m_nextPointId = m_points.size();
+    }
+
+    void takeSnapshot() {
+        m_saved_region_list.clear();
+        m_saved_region_list.reserve(m_region_list.size());
+        for (const MapRegion& region : m_region_list) {
+            m_saved_region_list.push_back(
+                {region.isVisited(), region.getName()});
+        }
+
+        m_saved_point_list.clear();
+        m_saved_point_list.reserve(m_points.size());
+        for (const MapPoint& point : m_points.getValues()) {
+            m_saved_point_list.insert(
+                point.getId(), {point.getName(), point.getPhotoList()});
         }
 
-        // Points
+        m_dirty_region_list.clear();
+        m_dirty_point_list.clear();
+    }
 
-        node = node.nextSibling();
-        element = node.toElement();
-        name = element.tagName();
-        Q_ASSERT(name == "g");
-        m_points_group = element;
+    // Saves only what has been touched since the last snapshot
+    void updateSnapshot() {
+        for (int id : qAsConst(m_dirty_region_list)) {
+            const MapRegion& region = m_region_list[id];
+            m_saved_region_list[id] = {region.isVisited(), region.getName()};
+        }
 
-        sub_node = node.firstChild();
-        while (!sub_node.isNull()) {
-            QDomElement sub_element = sub_node.toElement();
-            auto sub_name = sub_element.tagName();
-            if (sub_name == "circle") {
-                bool ok = false;
+        for (auto it = m_dirty_point_list.cbegin();
+                it != m_dirty_point_list.cend(); ++it) {
+            const MapPoint* point = m_points.get(it.value());
+            if (point != nullptr) {
+                m_saved_point_list.insert(
+                    it.key(), {point->getName(), point->getPhotoList()});
+            } else {
+                m_saved_point_list.remove(it.key());
+            }
+        }
 
-                Q_ASSERT(sub_element.hasAttribute("cx"));
-                float x = sub_element.attribute("cx").toFloat(&ok);
-                Q_ASSERT(ok);
+        m_dirty_region_list.clear();
+        m_dirty_point_list.clear();
+    }
 
-                Q_ASSERT(sub_element.hasAttribute("cy"));
-                float y = sub_element.attribute("cy").toFloat(&ok);
-                Q_ASSERT(ok);
+    // Compares the touched regions and points with the snapshot, so that
+    // the cost follows the number of edits rather than the map size
+    QList<QByteArray> getChanges() const {
+        QList<QByteArray> entry_list;
+
+        QList<int> region_id_list = m_dirty_region_list.values();
+        std::sort(region_id_list.begin(), region_id_list.end());
+        for (int id : qAsConst(region_id_list)) {
+            const MapRegion& region = m_region_list[id];
+            const SavedRegion& saved = m_saved_region_list[id];
+            if (region.isVisited() != saved.visited) {
+                entry_list.push_back(MapJournal::regionVisited(
+                    region.getIndex(), region.isVisited()));
+            }
+            if (region.getName() != saved.name) {
+                entry_list.push_back(MapJournal::regionName(
+                    region.getIndex(), region.getName()));
+            }
+        }
 
-                QString name("");
-                if (sub_element.hasChildNodes()) {
-                    QDomNode title_node = sub_node.firstChild();
-                    QDomElement title_element = title_node.toElement();
-                    name = title_element.text();
+        // Ids grow as points are added, so additions keep their order
+        QList<int> point_id_list = m_dirty_point_list.keys();
+        std::sort(point_id_list.begin(), point_id_list.end());
+        for (int id : qAsConst(point_id_list)) {
+            const MapPoint* point = m_points.get(m_dirty_point_list[id]);
+            auto saved = m_saved_point_list.constFind(id);
+            if (point == nullptr) {
+                if (saved != m_saved_point_list.constEnd()) {
+                    entry_list.push_back(MapJournal::pointRemoved(id));
                 }
-
-                m_point_list.emplace_back(
-                    m_doc, m_points_group, sub_element, QPointF(x, y), name);
+                continue;
+            }
+            if (saved == m_saved_point_list.constEnd()) {
+                entry_list.push_back(MapJournal::pointAdded(
+                    id, point->getPoint(), point->getName()));
+                if (!point->getPhotos().isEmpty()) {
+                    entry_list.push_back(MapJournal::pointPhotos(
+                        id, point->getPhotoList()));
+                }
+                continue;
+            }
+            if (saved->name != point->getName()) {
+                entry_list.push_back(MapJournal::pointName(
+                    id, point->getName()));
             }
+            if (saved->photos != point->getPhotoList()) {
+                entry_list.push_back(MapJournal::pointPhotos(
+                    id, point->getPhotoList()));
+            }
+        }
+
+        return entry_list;
+    }
 
-            sub_node = sub_node.nextSibling();
+    // Applies to the points as they are loaded, before they are stored
+    // in the slot map
+    void replay(
+            const MapJournal::Entry& entry,
+            QVector<MapPoint>& point_list) {
+        switch (entry.type) {
+        case MapJournal::RegionVisited:
+        case MapJournal::RegionName: {
+            auto region = std::lower_bound(
+                m_region_list.begin(), m_region_list.end(), entry.id,
+                [](const MapRegion& region, int index) {
+                    return region.getIndex() < index;
+                });
+            if (region == m_region_list.end() ||
+                    region->getIndex() != entry.id) {
+                break;
+            }
+            if (entry.type == MapJournal::RegionVisited) {
+                region->setVisited(entry.visited);
+            } else {
+                region->setName(entry.name);
+            }
+            break;
+        }
+        case MapJournal::PointAdded: {
+            point_list.emplace_back(entry.point, entry.name);
+            point_list.back().setId(entry.id);
+            m_nextPointId = qMax(m_nextPointId, entry.id + 1);
+            break;
+        }
+        case MapJournal::PointName:
+        case MapJournal::PointPhotos:
+        case MapJournal::PointRemoved: {
+            auto point = std::find_if(
+                point_list.begin(), point_list.end(),
+                [&entry](const MapPoint& point) {
+                    return point.getId() == entry.id;
+                });
+            if (point == point_list.end()) {
+                break;
+            }
+            if (entry.type == MapJournal::PointName) {
+                point->setName(entry.name);
+            } else if (entry.type == MapJournal::PointPhotos) {
+                point->setPhotoList(entry.name);
+            } else {
+                *point = point_list.back();
+                point_list.pop_back();
+            }
+            break;
+        }
         }
     }
 
 private:
+    QString m_filename;
+    QByteArray m_hash; // Of the svg as loaded or last compacted
+    bool m_valid;
+
     uint m_width;
     uint m_height;
     float m_pointRadius;
 
     QVector<MapRegion> m_region_list;
-    QVector<MapPoint> m_point_list;
-
-    QDomDocument m_doc;
-    QDomElement m_points_group;
+    SlotMap<MapPoint> m_points;
+    uint m_regionsVisited;
+    RegionIndex m_region_index;
+    PointIndex m_point_index;
+
+    int m_nextPointId;
+    int m_journalSize;
+    QVector<SavedRegion> m_saved_region_list;
+    QHash<int, SavedPoint> m_saved_point_list;
+    QSet<int> m_dirty_region_list; // Positions in the region list
+    QHash<int, PointHandle> m_dirty_point_list; // By point id, stale if removed
 };
 
 #endif // MAPOBJECT_H
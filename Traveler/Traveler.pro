@@ -1,4 +1,4 @@
-QT += widgets xml
+QT += widgets concurrent
 
 CONFIG += c++17
 TEMPLATE = app
@@ -8,9 +8,13 @@ TEMPLATE = app
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        batch.cpp \
         main.cpp \
         mainwindow.cpp \
+        maplayeritem.cpp \
+        maptilecache.cpp \
         mapview.cpp \
+        photostrip.cpp \
         photoview.cpp
 
 # Default rules for deployment.
@@ -19,12 +23,30 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    batch.h \
+    hovertracker.h \
     mainwindow.h \
-    mapobject.h \
+    mapcache.h \
+    mapcatalog.h \
+    mapfile.h \
+    mapjournal.h \
+    maplayeritem.h \
+    MapObject.h \
     mappoint.h \
     mapregion.h \
+    maptilecache.h \
     mapview.h \
-    photoview.h
+    pathparser.h \
+    photocache.h \
+    photostore.h \
+    photostrip.h \
+    photoview.h \
+    pointimporter.h \
+    pointindex.h \
+    polygonsimplifier.h \
+    regionindex.h \
+    slotmap.h \
+    trace.h
 
 RC_ICONS = ussr.ico
 
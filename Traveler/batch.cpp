@@ -0,0 +1,215 @@
+#include "batch.h"
+
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTextStream>
+
+#include <cstring>
+
+#include "mapcatalog.h"
+#include "photocache.h"
+#include "photostore.h"
+
+// Public Methods
+
+bool Batch::isRequested(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], OPTION) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Batch::run(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Applies changes to map files and prints their statistics as JSON. "
+        "Changed files are rewritten in full, so that the svg reflects "
+        "the changes rather than a journal next to it.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"batch", "Runs without the user interface."},
+        {"visit", "Marks the regions with the <name> visited.", "name"},
+        {"unvisit", "Marks the regions with the <name> not visited.", "name"},
+        {"add-point", "Adds a point at <x,y,name>.", "x,y,name"},
+        {"remove-point", "Removes the point at <x,y>.", "x,y"},
+        {"collect-photos",
+            "Removes stored photos that neither the files nor the maps "
+            "in the data directory refer to, and their cached versions."}
+    });
+    parser.addPositionalArgument("files", "Map files to process.", "<files...>");
+    parser.process(arguments);
+
+    QTextStream err(stderr);
+    const QStringList filename_list = parser.positionalArguments();
+    if (filename_list.isEmpty()) {
+        err << "No map files given" << Qt::endl;
+        return 1;
+    }
+
+    Changes changes;
+    changes.visited = parser.values("visit");
+    changes.unvisited = parser.values("unvisit");
+    for (const QString& text : parser.values("add-point")) {
+        QPointF point;
+        QString name;
+        if (!parsePoint(text, point, name) || name.isEmpty()) {
+            err << "Invalid point: " << text << Qt::endl;
+            return 1;
+        }
+        changes.addedPoints.push_back({point, name});
+    }
+    for (const QString& text : parser.values("remove-point")) {
+        QPointF point;
+        QString name;
+        if (!parsePoint(text, point, name)) {
+            err << "Invalid point: " << text << Qt::endl;
+            return 1;
+        }
+        changes.removedPoints.push_back(point);
+    }
+
+    int result = 0;
+    QJsonArray file_list;
+    QSet<QString> photo_list;
+    for (const QString& filename : filename_list) {
+        QJsonObject file = process(filename, changes, photo_list);
+        if (file.contains("error")) {
+            result = 1;
+        }
+        file_list.append(file);
+    }
+
+    // Photos of a file that failed to load can't be told apart
+    if (parser.isSet("collect-photos")) {
+        if (result == 0 && addCatalogPhotos(photo_list, err)) {
+            int count = PhotoStore::collectGarbage(photo_list);
+            err << "Removed " << count << " unreferenced photos" << Qt::endl;
+            count = PhotoCache::collectGarbage();
+            err << "Removed " << count << " cached photo versions" << Qt::endl;
+        } else {
+            err << "Photos are not collected because of errors" << Qt::endl;
+        }
+    }
+
+    QTextStream out(stdout);
+    out << QJsonDocument(file_list).toJson(QJsonDocument::Indented);
+    return result;
+}
+
+// Private Methods
+
+// Parses "x,y" or "x,y,name", the name may contain commas itself
+bool Batch::parsePoint(const QString& text, QPointF& point, QString& name) {
+    QStringList field_list = text.split(',');
+    if (field_list.size() < 2) {
+        return false;
+    }
+
+    bool ok_x = false, ok_y = false;
+    point = QPointF(
+        field_list[0].trimmed().toDouble(&ok_x),
+        field_list[1].trimmed().toDouble(&ok_y));
+    name = field_list.mid(2).join(',').trimmed();
+    return ok_x && ok_y;
+}
+
+void Batch::addPhotos(const MapObject& map, QSet<QString>& photo_list) {
+    for (const MapPoint& point : map.getPointList()) {
+        for (const QString& photo : point.getPhotos()) {
+            photo_list.insert(photo);
+        }
+    }
+}
+
+// Maps that aren't given on the command line refer to stored photos too
+bool Batch::addCatalogPhotos(QSet<QString>& photo_list, QTextStream& err) {
+    MapCatalog catalog;
+    catalog.scan();
+    for (int i = 0; i < catalog.size(); ++i) {
+        QString filePath = catalog.getSourceFilePath(i);
+        MapObject map(filePath);
+        if (!map.isValid()) {
+            err << "Unable to load map: " << filePath << Qt::endl;
+            return false;
+        }
+        addPhotos(map, photo_list);
+    }
+    return true;
+}
+
+QJsonObject Batch::process(
+        const QString& filename,
+        const Changes& changes,
+        QSet<QString>& photo_list) {
+    QJsonObject file{{"file", filename}};
+    if (!QFileInfo(filename).isFile()) {
+        file.insert("error", "File not found");
+        return file;
+    }
+
+    MapObject map(filename);
+    if (!map.isValid()) {
+        file.insert("error", "Unable to load map");
+        return file;
+    }
+
+    QJsonArray warning_list;
+
+    for (const QString& name : changes.visited) {
+        const auto region_list = map.findRegions(name);
+        if (region_list.isEmpty()) {
+            warning_list.append("Region not found: " + name);
+        }
+        for (MapRegion* region : region_list) {
+            map.setVisited(region, true);
+        }
+    }
+    for (const QString& name : changes.unvisited) {
+        const auto region_list = map.findRegions(name);
+        if (region_list.isEmpty()) {
+            warning_list.append("Region not found: " + name);
+        }
+        for (MapRegion* region : region_list) {
+            map.setVisited(region, false);
+        }
+    }
+
+    // Like in the view, points may only be placed on regions
+    for (const auto& added : changes.addedPoints) {
+        if (map.getRegion(added.first) == nullptr) {
+            warning_list.append(
+                "No region at point: " + added.second);
+            continue;
+        }
+        map.addPoint(added.first, added.second);
+    }
+    for (const QPointF& removed : changes.removedPoints) {
+        PointHandle point = map.findPoint(removed);
+        if (point.isNull()) {
+            warning_list.append(QString("No point at %1,%2")
+                .arg(removed.x()).arg(removed.y()));
+            continue;
+        }
+        map.removePoint(point);
+    }
+
+    // Other tools read the svg, so it is rewritten instead of journaled
+    if (!changes.isEmpty() && !map.compact(filename)) {
+        file.insert("error", "Unable to write map");
+    }
+
+    addPhotos(map, photo_list);
+
+    MapStats stats = map.getStats();
+    file.insert("regionsTotal", qint64(stats.regionsTotal));
+    file.insert("regionsVisited", qint64(stats.regionsVisited));
+    file.insert("pointsVisited", qint64(stats.pointsVisited));
+    if (!warning_list.isEmpty()) {
+        file.insert("warnings", warning_list);
+    }
+    return file;
+}
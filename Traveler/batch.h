@@ -0,0 +1,43 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <QJsonObject>
+#include <QSet>
+#include <QStringList>
+#include <QTextStream>
+
+#include "MapObject.h"
+
+// Command-line mode working on map files without a display. Every change
+// given on the command line is applied to every file in turn, then the
+// file is saved and its statistics are printed as JSON.
+class Batch {
+public:
+    static constexpr const char* OPTION = "--batch";
+
+    static bool isRequested(int argc, char *argv[]);
+    static int run(const QStringList& arguments);
+
+private:
+    struct Changes {
+        QStringList visited;
+        QStringList unvisited;
+        QVector<QPair<QPointF, QString>> addedPoints;
+        QVector<QPointF> removedPoints;
+
+        bool isEmpty() const {
+            return visited.isEmpty() && unvisited.isEmpty() &&
+                addedPoints.isEmpty() && removedPoints.isEmpty();
+        }
+    };
+
+    static bool parsePoint(const QString& text, QPointF& point, QString& name);
+    static void addPhotos(const MapObject& map, QSet<QString>& photo_list);
+    static bool addCatalogPhotos(QSet<QString>& photo_list, QTextStream& err);
+    static QJsonObject process(
+            const QString& filename,
+            const Changes& changes,
+            QSet<QString>& photo_list);
+};
+
+#endif // BATCH_H
@@ -0,0 +1,256 @@
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "MapObject.h"
+
+// Measures the map model on copies of the base maps, so that neither the
+// data directory nor its cache and journal files are touched
+class MapObjectBench : public QObject {
+    Q_OBJECT
+private slots:
+    void initTestCase();
+
+    void construct_data();
+    void construct();
+    void constructCached_data();
+    void constructCached();
+
+    void getRegion_data();
+    void getRegion();
+    void getPoint_data();
+    void getPoint();
+
+    void addRemovePoint_data();
+    void addRemovePoint();
+
+    void getStats_data();
+    void getStats();
+
+    void store_data();
+    void store();
+    void storeCompact_data();
+    void storeCompact();
+
+private:
+    static constexpr int QUERY_COUNT = 10000;
+    static constexpr int POINT_COUNT = 1000;
+    static constexpr int STORE_COUNT = 500; // Below the journal limit
+    static constexpr int STORE_RUNS = 10;
+
+    void addMaps();
+    QString copyMap(const QString& name);
+    static QVector<QPointF> randomPoints(const MapObject& map, int count);
+
+private:
+    QTemporaryDir m_dir;
+    int m_copies = 0;
+};
+
+void MapObjectBench::initTestCase() {
+    QVERIFY(m_dir.isValid());
+}
+
+// Parses the svg, the cache is removed before every run
+void MapObjectBench::construct_data() {
+    addMaps();
+}
+
+void MapObjectBench::construct() {
+    QFETCH(QString, map);
+    QString filename = copyMap(map);
+    QString cache = MapCache::getCacheFilename(filename);
+
+    QBENCHMARK {
+        QFile::remove(cache);
+        MapObject object(filename);
+    }
+}
+
+void MapObjectBench::constructCached_data() {
+    addMaps();
+}
+
+void MapObjectBench::constructCached() {
+    QFETCH(QString, map);
+    QString filename = copyMap(map);
+    {
+        MapObject object(filename); // Writes the cache
+    }
+
+    QBENCHMARK {
+        MapObject object(filename);
+    }
+}
+
+void MapObjectBench::getRegion_data() {
+    addMaps();
+}
+
+void MapObjectBench::getRegion() {
+    QFETCH(QString, map);
+    MapObject object(copyMap(map));
+    const auto point_list = randomPoints(object, QUERY_COUNT);
+
+    int found = 0;
+    QBENCHMARK {
+        for (const QPointF& point : point_list) {
+            found += object.getRegion(point) != nullptr;
+        }
+    }
+    QVERIFY(found > 0);
+}
+
+void MapObjectBench::getPoint_data() {
+    addMaps();
+}
+
+void MapObjectBench::getPoint() {
+    QFETCH(QString, map);
+    MapObject object(copyMap(map));
+    for (const QPointF& point : randomPoints(object, POINT_COUNT)) {
+        object.addPoint(point, "Point");
+    }
+    const auto point_list = randomPoints(object, QUERY_COUNT);
+
+    int found = 0;
+    QBENCHMARK {
+        for (const QPointF& point : point_list) {
+            found += !object.findPoint(point).isNull();
+        }
+    }
+    Q_UNUSED(found);
+}
+
+void MapObjectBench::addRemovePoint_data() {
+    addMaps();
+}
+
+// Adds a batch of points and removes them in the same order, which moves
+// the last point in place of every removed one
+void MapObjectBench::addRemovePoint() {
+    QFETCH(QString, map);
+    MapObject object(copyMap(map));
+    const auto point_list = randomPoints(object, POINT_COUNT);
+
+    QBENCHMARK {
+        for (const QPointF& point : point_list) {
+            object.addPoint(point, "Point");
+        }
+        for (const QPointF& point : point_list) {
+            PointHandle handle = object.findPoint(point);
+            Q_ASSERT(!handle.isNull());
+            object.removePoint(handle);
+        }
+    }
+    QCOMPARE(object.getPointList().size(), 0);
+}
+
+void MapObjectBench::getStats_data() {
+    addMaps();
+}
+
+void MapObjectBench::getStats() {
+    QFETCH(QString, map);
+    MapObject object(copyMap(map));
+
+    MapStats stats;
+    QBENCHMARK {
+        stats = object.getStats();
+    }
+    QVERIFY(stats.regionsTotal > 0);
+}
+
+void MapObjectBench::store_data() {
+    addMaps();
+}
+
+// Toggles a region and saves to the loaded file, appending to its journal.
+// The map is compacted between the timed runs, so that no timed save
+// crosses the journal limit, compaction is measured by storeCompact.
+void MapObjectBench::store() {
+    QFETCH(QString, map);
+    QString filename = copyMap(map);
+    MapObject object(filename);
+    MapRegion* region = nullptr;
+    for (const QPointF& point : randomPoints(object, QUERY_COUNT)) {
+        region = object.getRegion(point);
+        if (region != nullptr) {
+            break;
+        }
+    }
+    QVERIFY(region != nullptr);
+
+    qint64 elapsed = 0;
+    for (int run = 0; run < STORE_RUNS; ++run) {
+        QVERIFY(object.compact(filename));
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < STORE_COUNT; ++i) {
+            object.setVisited(region, !region->isVisited());
+            object.store(filename);
+        }
+        elapsed += timer.nsecsElapsed();
+    }
+    QTest::setBenchmarkResult(
+        qreal(elapsed) / (STORE_RUNS * STORE_COUNT),
+        QTest::WalltimeNanoseconds);
+}
+
+void MapObjectBench::storeCompact_data() {
+    addMaps();
+}
+
+// Saves into the other of two files every time, so that each save
+// rewrites the whole svg
+void MapObjectBench::storeCompact() {
+    QFETCH(QString, map);
+    QString filename = copyMap(map);
+    MapObject object(filename);
+    for (const QPointF& point : randomPoints(object, POINT_COUNT)) {
+        object.addPoint(point, "Point");
+    }
+
+    QString target_list[] = {filename + ".compact.svg", filename};
+    int target = 0;
+    QBENCHMARK {
+        object.store(target_list[target]);
+        target = 1 - target;
+    }
+}
+
+// Private Methods
+
+void MapObjectBench::addMaps() {
+    QTest::addColumn<QString>("map");
+    QTest::newRow("russia") << "russia-base.svg";
+    QTest::newRow("world") << "world-base.svg";
+}
+
+QString MapObjectBench::copyMap(const QString& name) {
+    QString source = QDir(DATA_PATH).filePath(name);
+    QString target = m_dir.filePath(QString::number(m_copies++) + "-" + name);
+    if (!QFile::copy(source, target)) {
+        qFatal("Unable to copy %s", qPrintable(source));
+    }
+    return target;
+}
+
+// Deterministic, so that runs are comparable
+QVector<QPointF> MapObjectBench::randomPoints(const MapObject& map, int count) {
+    QRandomGenerator random(42);
+    QSize size = map.getSize();
+    QVector<QPointF> point_list;
+    point_list.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        point_list.push_back(QPointF(
+            random.bounded(double(size.width())),
+            random.bounded(double(size.height()))));
+    }
+    return point_list;
+}
+
+QTEST_GUILESS_MAIN(MapObjectBench)
+
+#include "bench.moc"
@@ -0,0 +1,17 @@
+QT += testlib concurrent
+QT -= widgets
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = bench
+
+# Benchmarks of the map model on the base maps.
+# Run with e.g. "bench -o results.xml,xml" or "bench -csv" to get
+# machine-readable results.
+
+INCLUDEPATH += ..
+DEFINES += DATA_PATH=\\\"$$PWD/../../data\\\"
+
+SOURCES += \
+        bench.cpp
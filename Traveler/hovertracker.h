@@ -0,0 +1,58 @@
+#ifndef HOVERTRACKER_H
+#define HOVERTRACKER_H
+
+#include "MapObject.h"
+
+#include <QPointF>
+
+// Object under the mouse. Consecutive hit-tests mostly land on the same
+// region, so the previous one is re-checked before the region index is
+// queried. Points take precedence over regions and always come from the
+// point index, as only it knows which of overlapping points is nearest.
+class HoverTracker {
+public:
+    HoverTracker() : m_region(nullptr) {}
+
+    void reset() {
+        m_point = PointHandle();
+        m_region = nullptr;
+    }
+
+    // Returns true if the hovered object has changed
+    bool update(MapObject* map, QPointF point) {
+        Q_ASSERT(map != nullptr);
+        PointHandle handle = map->findPoint(point);
+        MapRegion* region = handle.isNull() ? hitRegion(map, point) : nullptr;
+
+        bool changed = handle != m_point || region != m_region;
+        m_point = handle;
+        m_region = region;
+        return changed;
+    }
+
+    // Name of the hovered object, or an empty string
+    QString getText(const MapObject* map) const {
+        const MapPoint* point = map->getPoint(m_point);
+        if (point != nullptr) {
+            return point->getName();
+        }
+        if (m_region != nullptr) {
+            return m_region->getName();
+        }
+        return QString();
+    }
+
+private:
+    MapRegion* hitRegion(MapObject* map, QPointF point) const {
+        if (m_region != nullptr && m_region->contains(point)) {
+            return m_region;
+        }
+        return map->getRegion(point);
+    }
+
+private:
+    PointHandle m_point;
+    MapRegion* m_region; // Owned by the map
+};
+
+#endif // HOVERTRACKER_H
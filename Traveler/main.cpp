@@ -1,20 +1,56 @@
 #include <QApplication>
 
+#include "batch.h"
 #include "mainwindow.h"
+#include "trace.h"
 
 #define NAME "Traveler"
 #define VERSION "1.0"
 
-int main(int argc, char *argv[]) {
-    QApplication a(argc, argv);
+// Tracing is turned on by --trace <file> or the environment variable
+static void startTrace(QStringList& arguments) {
+    QString traceFilename = qEnvironmentVariable(Trace::ENVIRONMENT_VARIABLE);
+    int traceArgument = arguments.indexOf("--trace");
+    if (traceArgument >= 0 && traceArgument + 1 < arguments.size()) {
+        traceFilename = arguments[traceArgument + 1];
+        arguments.remove(traceArgument, 2);
+    }
+    if (!traceFilename.isEmpty()) {
+        Trace::start(traceFilename);
+    }
+}
 
+int main(int argc, char *argv[]) {
     QString appName(NAME);
     appName = appName + " [" + VERSION + "]";
+
+    // The batch mode must not require a display
+    if (Batch::isRequested(argc, argv)) {
+        QCoreApplication a(argc, argv);
+        QCoreApplication::setApplicationName(appName);
+
+        QStringList arguments = QCoreApplication::arguments();
+        startTrace(arguments);
+        int result = Batch::run(arguments);
+        Trace::stop();
+        return result;
+    }
+
+    QApplication a(argc, argv);
+    QCoreApplication::setOrganizationName(NAME); // Locates the settings
     QCoreApplication::setApplicationName(appName);
     QGuiApplication::setApplicationDisplayName(QCoreApplication::applicationName());
 
-    MainWindow window;
-    window.show();
+    QStringList arguments = QCoreApplication::arguments();
+    startTrace(arguments);
+
+    int result = 0;
+    {
+        MainWindow window;
+        window.show();
+        result = a.exec();
+    }
 
-    return a.exec();
+    Trace::stop();
+    return result;
 }
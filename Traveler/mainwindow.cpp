@@ -1,32 +1,57 @@
 #include "mainwindow.h"
 
+#include <QActionGroup>
+#include <QFileDialog>
 #include <QGroupBox>
 #include <QMenuBar>
+#include <QMessageBox>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QScreen>
+#include <QSettings>
+#include <QStatusBar>
 #include <QStyle>
+#include <QThreadPool>
+
+#include "photocache.h"
+#include "photostore.h"
 
 MainWindow::MainWindow(QWidget *parent)
         : QMainWindow{parent}, m_view(new MapView), m_photo(new PhotoView),
-          m_currentRegion(nullptr), m_currentPoint(nullptr) {
+          m_strip(new PhotoStrip),
+          m_currentRegion(nullptr), m_currentMap(-1) {
     // Make menu
 
     QMenuBar* menuBar = this->menuBar();
     QMenu* menu = new QMenu("&File");
-    QAction* russiaAction = menu->addAction("&Russia", this, SLOT(selectRussia()));
-    russiaAction->setCheckable(true);
-    russiaAction->setChecked(true);
-    QAction* worldAction = menu->addAction("&World", this, SLOT(selectWorld()));
-    worldAction->setCheckable(true);
-    worldAction->setChecked(false);
+
+    // One entry per map found in the data directory
+    m_catalog.scan();
+    m_view->setCatalog(&m_catalog);
+    int lastMap = getLastMap();
+    QActionGroup* mapGroup = new QActionGroup(this);
+    for (int i = 0; i < m_catalog.size(); ++i) {
+        QAction* action = menu->addAction(m_catalog.getEntry(i).title);
+        action->setCheckable(true);
+        action->setChecked(i == lastMap);
+        mapGroup->addAction(action);
+        QObject::connect(
+            action, &QAction::triggered,
+            this, [this, i]() { selectMap(i); });
+        QObject::connect(
+            action, &QAction::hovered,
+            this, [this, action, i]() {
+                action->setStatusTip(getMapInfo(i));
+            });
+    }
+    if (m_catalog.size() > 0) {
+        menu->addSeparator();
+    }
+    menu->addAction("&Import Points...", this, SLOT(importPoints()));
     menu->addSeparator();
     menu->addAction("&Exit", this, SLOT(close()));
     menuBar->addMenu(menu);
 
-    m_russiaAction = russiaAction;
-    m_worldAction = worldAction;
-
     // Make layout
 
     //// Properties
@@ -63,6 +88,7 @@ MainWindow::MainWindow(QWidget *parent)
     propsLayout->addLayout(nameLayout);
     propsLayout->addLayout(visitedLayout);
     propsLayout->addWidget(m_photo);
+    propsLayout->addWidget(m_strip);
     propsLayout->addWidget(saveButton);
 
     QGroupBox* propsBox = new QGroupBox("Properties");
@@ -114,6 +140,17 @@ MainWindow::MainWindow(QWidget *parent)
     m_regionsVisited = regionsVisited;
     m_pointsVisited = pointsVisited;
 
+    //// Loading indicator
+
+    QProgressBar* loading = new QProgressBar();
+    Q_ASSERT(loading != nullptr);
+    loading->setRange(0, 0);
+    loading->setMaximumWidth(200);
+    loading->hide();
+    statusBar()->addPermanentWidget(loading);
+
+    m_loading = loading;
+
     resetPanels();
 
     // Center window
@@ -125,9 +162,6 @@ MainWindow::MainWindow(QWidget *parent)
             QSize(1800, 1000),
             screen()->availableGeometry()));
 
-    // Set title
-    setWindowTitle("Russia");
-
     // Set signals
 
     QObject::connect(
@@ -145,17 +179,47 @@ MainWindow::MainWindow(QWidget *parent)
         m_view, SIGNAL(pointAdded()),
         this, SLOT(pointAdded()));
     QObject::connect(
-        m_view, SIGNAL(pointChecked(MapPoint*)),
-        this, SLOT(pointChecked(MapPoint*)));
+        m_view, SIGNAL(pointChecked(PointHandle)),
+        this, SLOT(pointChecked(PointHandle)));
     QObject::connect(
         m_view, SIGNAL(pointUnchecked()),
         this, SLOT(pointUnchecked()));
 
+    QObject::connect(
+        m_strip, &PhotoStrip::photoSelected,
+        m_photo, &PhotoView::load);
+    QObject::connect(
+        m_strip, &PhotoStrip::addRequested,
+        m_photo, &PhotoView::selectPhotos);
+    QObject::connect(
+        m_photo, &PhotoView::photosAdded,
+        m_strip, &PhotoStrip::addPhotos);
+    QObject::connect(
+        m_photo, &PhotoView::photoRemoved,
+        m_strip, &PhotoStrip::removePhoto);
+
     QObject::connect(
         m_view, SIGNAL(statsChanged(uint,uint,uint)),
         this, SLOT(statsChanged(uint,uint,uint)));
 
-    m_view->updateStats();
+    QObject::connect(
+        m_view, SIGNAL(loadingStarted()),
+        this, SLOT(loadingStarted()));
+    QObject::connect(
+        m_view, SIGNAL(loadingFinished()),
+        this, SLOT(loadingFinished()));
+    QObject::connect(
+        m_view, SIGNAL(loadFailed()),
+        this, SLOT(loadFailed()));
+
+    // The map is loaded in background once the window is shown
+    if (lastMap >= 0) {
+        selectMap(lastMap);
+    } else {
+        setWindowTitle("Traveler");
+    }
+
+    QThreadPool::globalInstance()->start(&PhotoCache::backfill);
 }
 
 // Protected Signals
@@ -173,14 +237,18 @@ void MainWindow::regionChecked(MapRegion* region) {
     Q_ASSERT(m_currentRegion == nullptr);
     m_currentRegion = region;
     m_currentRegion->setChecked(true);
+    m_view->updateRegion(m_currentRegion);
 
     setPanels("Region", m_currentRegion->getName(), m_currentRegion->isVisited());
     m_photo->disable();
+    m_strip->setPhotos(QStringList());
+    m_strip->setEnabled(false);
 }
 
 void MainWindow::regionUnchecked() {
     if (m_currentRegion != nullptr) {
         m_currentRegion->setChecked(false);
+        m_view->updateRegion(m_currentRegion);
         m_currentRegion = nullptr;
     }
 
@@ -189,27 +257,27 @@ void MainWindow::regionUnchecked() {
 
 void MainWindow::saved() {
     if (m_currentRegion != nullptr) {
-        m_currentRegion->setName(m_name->text());
-        m_currentRegion->setVisited(m_flag->isChecked());
+        m_view->setRegionName(m_currentRegion, m_name->text());
+        m_view->setVisited(m_currentRegion, m_flag->isChecked());
         regionUnchecked();
         m_view->markChanged();
     } else {
-        if (m_currentPoint != nullptr) {
+        MapPoint* point = m_view->getPoint(m_currentPoint);
+        if (point != nullptr) {
             if (m_flag->isChecked()) {
-                m_currentPoint->setName(m_name->text());
-                m_currentPoint->setPhoto(
-                            m_photo->filename(),
-                            getMapPrefix());
+                m_view->setPointName(m_currentPoint, m_name->text());
+                m_view->setPointPhotos(
+                    m_currentPoint, storePhotos(point, m_strip->getPhotos()));
             } else {
                 m_view->removePoint(m_currentPoint);
+                m_currentPoint = PointHandle();
             }
             m_view->markChanged();
         } else {
             if (m_flag->isChecked()) {
-                MapPoint* point = m_view->addNewPoint(m_name->text());
-                point->setPhoto(
-                            m_photo->filename(),
-                            getMapPrefix());
+                PointHandle handle = m_view->addNewPoint(m_name->text());
+                m_view->setPointPhotos(handle, storePhotos(
+                    m_view->getPoint(handle), m_strip->getPhotos()));
                 m_view->markChanged();
             }
         }
@@ -218,54 +286,100 @@ void MainWindow::saved() {
         pointUnchecked();
     }
 
-    m_view->updateScene();
+    m_view->store();
 }
 
 void MainWindow::pointAdded() {
-    Q_ASSERT(m_currentPoint == nullptr);
+    Q_ASSERT(m_currentPoint.isNull());
     setPanels("Point:", "", true);
     m_photo->enable();
+    m_strip->setPhotos(QStringList());
+    m_strip->setEnabled(true);
 }
 
-void MainWindow::pointChecked(MapPoint* point) {
+void MainWindow::pointChecked(PointHandle handle) {
+    MapPoint* point = m_view->getPoint(handle);
     Q_ASSERT(point != nullptr);
 
-    Q_ASSERT(m_currentPoint == nullptr);
-    m_currentPoint = point;
-    m_currentPoint->setChecked(true);
+    Q_ASSERT(m_currentPoint.isNull());
+    m_currentPoint = handle;
+    point->setChecked(true);
+    m_view->updatePoint(m_currentPoint);
 
     setPanels("Point:", point->getName(), true);
     m_photo->enable();
-    m_photo->load(m_currentPoint->getPhotoFilePath(getMapPrefix()));
+    m_strip->setEnabled(true);
+
+    QStringList photos;
+    for (const auto& key : point->getPhotos()) {
+        photos.push_back(PhotoStore::getFilePath(key));
+    }
+    QString legacy = point->getLegacyPhotoFilePath(getMapPrefix());
+    if (photos.isEmpty() && QFileInfo::exists(legacy)) {
+        photos.push_back(legacy);
+    }
+    m_strip->setPhotos(photos);
 }
 
 void MainWindow::pointUnchecked() {
-    if (m_currentPoint != nullptr) {
-        m_currentPoint->setChecked(false);
-        m_currentPoint = nullptr;
+    MapPoint* point = m_view->getPoint(m_currentPoint);
+    if (point != nullptr) {
+        point->setChecked(false);
+        m_view->updatePoint(m_currentPoint);
     }
+    m_currentPoint = PointHandle();
 
     resetPanels();
 }
 
-void MainWindow::selectRussia() {
-    m_worldAction->setChecked(false);
-    m_russiaAction->setChecked(true);
-    m_view->selectLocation(Location::Russia);
-    setWindowTitle("Russia");
-    resetPanels();
-    m_currentPoint = nullptr;
-    m_currentRegion = nullptr;
+void MainWindow::selectMap(int index) {
+    if (index == m_currentMap) {
+        return;
+    }
+
+    // The previous map stays cached, so nothing may remain checked on it
+    regionUnchecked();
+    pointUnchecked();
+    m_view->unsetNewPoint();
+
+    m_currentMap = index;
+    const MapCatalog::Entry& entry = m_catalog.getEntry(m_currentMap);
+    m_view->selectMap(entry.filePath, entry.baseFilePath);
+    setWindowTitle(entry.title);
+    QSettings().setValue(LAST_MAP_KEY, entry.name);
 }
 
-void MainWindow::selectWorld() {
-    m_worldAction->setChecked(true);
-    m_russiaAction->setChecked(false);
-    m_view->selectLocation(Location::World);
-    setWindowTitle("World");
-    resetPanels();
-    m_currentPoint = nullptr;
-    m_currentRegion = nullptr;
+void MainWindow::importPoints() {
+    QString filename = QFileDialog::getOpenFileName(
+        this, "Import Points", QString(), "Points (*.csv *.gpx)");
+    if (filename.isEmpty()) {
+        return;
+    }
+
+    QVector<PointImporter::Point> point_list;
+    bool geographic = false;
+    QString error;
+    int count = -1;
+    if (PointImporter::read(filename, point_list, geographic, error)) {
+        // Nothing may stay checked, as the point list grows
+        regionUnchecked();
+        pointUnchecked();
+        m_view->unsetNewPoint();
+        count = m_view->importPoints(point_list, geographic, error);
+    }
+
+    QMessageBox msgBox;
+    msgBox.setWindowTitle("Import Points");
+    if (count < 0) {
+        msgBox.setText("Unable to import points: " + error);
+    } else {
+        msgBox.setText(
+            QString("Imported %1 of %2 points, duplicates and points "
+                    "outside of regions were skipped.")
+                .arg(count).arg(point_list.size()));
+        m_view->store();
+    }
+    msgBox.exec();
 }
 
 void MainWindow::statsChanged(
@@ -284,6 +398,19 @@ void MainWindow::statsChanged(
     m_pointsVisited->setText(points);
 }
 
+void MainWindow::loadingStarted() {
+    m_loading->show();
+}
+
+void MainWindow::loadingFinished() {
+    m_loading->hide();
+}
+
+// No map is shown, so selecting the same one again retries
+void MainWindow::loadFailed() {
+    m_currentMap = -1;
+}
+
 // Private Methods
 
 void MainWindow::setPanels(const QString& label, const QString& text, bool flag) {
@@ -310,8 +437,82 @@ void MainWindow::resetPanels() {
     m_label->setText("Region/Point:");
 
     m_photo->disable();
+    m_strip->setPhotos(QStringList());
+    m_strip->setEnabled(false);
+}
+
+// Takes the photos into the photo store and returns their keys. Photos
+// that can't be stored are skipped. A legacy photo of the point is moved
+// into the store.
+QStringList MainWindow::storePhotos(
+        const MapPoint* point, const QStringList& filenames) {
+    QStringList key_list;
+    QStringList failed_list;
+    for (const auto& filename : filenames) {
+        // Already stored photos are not hashed again
+        QString name = QFileInfo(filename).fileName();
+        if (name.size() > 2 && filename == PhotoStore::getFilePath(name)) {
+            key_list.push_back(name);
+            continue;
+        }
+
+        QString key = PhotoStore::store(filename);
+        if (key.isEmpty()) {
+            failed_list.push_back(filename);
+            continue;
+        }
+
+        if (filename == point->getLegacyPhotoFilePath(getMapPrefix())) {
+            QFile::remove(filename);
+        }
+
+        QThreadPool::globalInstance()->start([key]() {
+            PhotoCache::generate(key);
+        });
+        key_list.push_back(key);
+    }
+
+    if (!failed_list.isEmpty()) {
+        QMessageBox msgBox;
+        msgBox.setText("Unable to store photos:\n" + failed_list.join('\n'));
+        msgBox.setWindowTitle("Warning");
+        msgBox.exec();
+    }
+
+    key_list.removeDuplicates();
+    return key_list;
+}
+
+// The metadata is read when the map is first hovered in the menu
+QString MainWindow::getMapInfo(int index) const {
+    const MapCatalog::Info& info = m_catalog.getInfo(index);
+    QString text = m_catalog.getEntry(index).title;
+    if (info.size.isValid()) {
+        text += QString(": %1 x %2")
+            .arg(info.size.width()).arg(info.size.height());
+    }
+    if (info.regionCount >= 0) {
+        text += QString(", %1 regions").arg(info.regionCount);
+    }
+    return text;
+}
+
+// The map used last, or the default one the first time. Returns -1 if
+// the catalog is empty.
+int MainWindow::getLastMap() const {
+    int index = m_catalog.indexOf(QSettings().value(LAST_MAP_KEY).toString());
+    if (index < 0) {
+        index = m_catalog.indexOf(DEFAULT_MAP);
+    }
+    if (index < 0 && m_catalog.size() > 0) {
+        index = 0;
+    }
+    return index;
 }
 
 QString MainWindow::getMapPrefix() const {
-    return m_russiaAction->isChecked() ? "russia" : "world";
+    if (m_currentMap < 0) {
+        return QString();
+    }
+    return m_catalog.getEntry(m_currentMap).name;
 }
@@ -6,9 +6,12 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QMainWindow>
+#include <QProgressBar>
 #include <QPushButton>
 
+#include "mapcatalog.h"
 #include "mapview.h"
+#include "photostrip.h"
 #include "photoview.h"
 
 class MainWindow : public QMainWindow {
@@ -23,30 +26,41 @@ protected slots:
     void saved();
 
     void pointAdded();
-    void pointChecked(MapPoint* point);
+    void pointChecked(PointHandle handle);
     void pointUnchecked();
 
-    void selectRussia();
-    void selectWorld();
+    void selectMap(int index);
+    void importPoints();
 
     void statsChanged(
             uint regionsTotal,
             uint regionsVisited,
             uint pointsVisited);
 
+    void loadingStarted();
+    void loadingFinished();
+    void loadFailed();
+
 protected:
     void closeEvent(QCloseEvent *event) override;
 
 private:
     void setPanels(const QString& label, const QString& text, bool flag);
     void resetPanels();
+    QString getMapInfo(int index) const;
+    int getLastMap() const;
+    QStringList storePhotos(const MapPoint* point, const QStringList& filenames);
     QString getMapPrefix() const;
 
 private:
+    static constexpr const char* LAST_MAP_KEY = "map/last"; // Setting
+    static constexpr const char* DEFAULT_MAP = "russia";
+
     MapView* m_view;
     PhotoView* m_photo;
+    PhotoStrip* m_strip;
     MapRegion* m_currentRegion;
-    MapPoint* m_currentPoint;
+    PointHandle m_currentPoint;
 
     QLineEdit* m_name;
     QCheckBox* m_flag;
@@ -55,9 +69,10 @@ private:
 
     QLabel* m_regionsVisited;
     QLabel* m_pointsVisited;
+    QProgressBar* m_loading;
 
-    QAction* m_russiaAction;
-    QAction* m_worldAction;
+    MapCatalog m_catalog;
+    int m_currentMap; // In the catalog
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,327 @@
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+
+#include "mappoint.h"
+#include "mapregion.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QVector>
+
+#include <cstring>
+
+// Binary cache of a parsed map, stored next to the svg as <svg>.cache.
+// It holds the parsed regions, polygons and their simplified levels, names
+// and points in native byte order and is memory-mapped on load. The cache is only used when
+// the size, modification time and hash of the svg match its header. The
+// hash is taken by the caller, so that the svg is read once per load.
+class MapCache {
+public:
+    static QString getCacheFilename(const QString& filename) {
+        return filename + ".cache";
+    }
+
+    static QByteArray hashFile(const QString& filename) {
+        QFile file(filename);
+        if (!file.open(QFile::ReadOnly)) {
+            return QByteArray();
+        }
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(&file);
+        return hash.result();
+    }
+
+    static bool read(
+            const QString& filename, const QByteArray& file_hash,
+            uint& width, uint& height,
+            QVector<MapRegion>& region_list,
+            QVector<MapPoint>& point_list) {
+        QFile file(getCacheFilename(filename));
+        if (!file.open(QFile::ReadOnly)) {
+            return false;
+        }
+
+        const uchar* data = file.map(0, file.size());
+        if (data == nullptr) {
+            return false;
+        }
+
+        Reader reader{data, data + file.size()};
+        bool ok = readContent(
+            reader, filename, file_hash, width, height,
+            region_list, point_list);
+        file.unmap(const_cast<uchar*>(data));
+
+        if (!ok) {
+            region_list.clear();
+            point_list.clear();
+        }
+        return ok;
+    }
+
+    // Region count from the cache, or -1. Only the size and modification
+    // time of the svg are checked, so it is meant for display.
+    static int readRegionCount(const QString& filename) {
+        QFile file(getCacheFilename(filename));
+        if (!file.open(QFile::ReadOnly)) {
+            return -1;
+        }
+
+        const qint64 header_size = sizeof(MAGIC) + sizeof(quint32) +
+            2 * sizeof(qint64) + HASH_SIZE + 3 * sizeof(quint32);
+        QByteArray header = file.read(header_size);
+        Reader reader{
+            reinterpret_cast<const uchar*>(header.constData()),
+            reinterpret_cast<const uchar*>(header.constData()) + header.size()};
+
+        char magic[sizeof(MAGIC)];
+        quint32 version = 0;
+        qint64 size = 0;
+        qint64 modified = 0;
+        char hash[HASH_SIZE];
+        quint32 width = 0, height = 0, region_count = 0;
+        if (!reader.get(magic, sizeof(magic)) ||
+                memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+                !reader.get(version) || version != VERSION ||
+                !reader.get(size) || !reader.get(modified) ||
+                !reader.get(hash, HASH_SIZE) ||
+                !reader.get(width) || !reader.get(height) ||
+                !reader.get(region_count)) {
+            return -1;
+        }
+
+        QFileInfo info(filename);
+        if (info.size() != size ||
+                info.lastModified().toMSecsSinceEpoch() != modified) {
+            return -1;
+        }
+        return region_count;
+    }
+
+    static void write(
+            const QString& filename, const QByteArray& hash,
+            uint width, uint height,
+            const QVector<MapRegion>& region_list,
+            const QVector<MapPoint>& point_list) {
+        QFileInfo info(filename);
+        if (!info.exists() || hash.size() != HASH_SIZE) {
+            return;
+        }
+
+        QByteArray data;
+        put(data, MAGIC, sizeof(MAGIC));
+        put<quint32>(data, VERSION);
+        put<qint64>(data, info.size());
+        put<qint64>(data, info.lastModified().toMSecsSinceEpoch());
+        put(data, hash.constData(), HASH_SIZE);
+
+        put<quint32>(data, width);
+        put<quint32>(data, height);
+
+        put<quint32>(data, region_list.size());
+        for (const MapRegion& region : region_list) {
+            put<quint32>(data, region.getIndex());
+            put<quint8>(data, region.isVisited() ? 1 : 0);
+            putString(data, region.getName());
+            putString(data, region.getChildMap());
+            const QTransform& transform = region.getChildTransform();
+            for (qreal value : {transform.m11(), transform.m12(),
+                                transform.m21(), transform.m22(),
+                                transform.dx(), transform.dy()}) {
+                put<qreal>(data, value);
+            }
+            for (int level = 0; level < MapRegion::LEVEL_COUNT; ++level) {
+                putPolygons(data, region.getPolygonList(level));
+            }
+        }
+
+        put<quint32>(data, point_list.size());
+        for (const MapPoint& point : point_list) {
+            put<qreal>(data, point.getPoint().x());
+            put<qreal>(data, point.getPoint().y());
+            putString(data, point.getName());
+            putString(data, point.getPhotoList());
+        }
+
+        // A cache that can't be written is simply rebuilt next time
+        QSaveFile file(getCacheFilename(filename));
+        if (file.open(QFile::WriteOnly)) {
+            file.write(data);
+            file.commit();
+        }
+    }
+
+private:
+    static constexpr char MAGIC[8] = {'T', 'R', 'V', 'L', 'M', 'A', 'P', 0};
+    static constexpr quint32 VERSION = 5;
+    static constexpr int HASH_SIZE = 20;
+
+    struct Reader {
+        const uchar* pos;
+        const uchar* end;
+
+        bool get(void* value, qint64 size) {
+            if (size < 0 || end - pos < size) {
+                return false;
+            }
+            memcpy(value, pos, size);
+            pos += size;
+            return true;
+        }
+
+        template <typename T>
+        bool get(T& value) {
+            return get(&value, sizeof(T));
+        }
+
+        bool getString(QString& value) {
+            quint32 size = 0;
+            if (!get(size) || quint64(end - pos) < quint64(size) * 2) {
+                return false;
+            }
+            value.resize(size);
+            return get(value.data(), qint64(size) * 2);
+        }
+    };
+
+    static void put(QByteArray& data, const void* value, qint64 size) {
+        data.append(static_cast<const char*>(value), size);
+    }
+
+    template <typename T>
+    static void put(QByteArray& data, T value) {
+        put(data, &value, sizeof(T));
+    }
+
+    static void putString(QByteArray& data, const QString& value) {
+        put<quint32>(data, value.size());
+        put(data, value.constData(), value.size() * 2);
+    }
+
+    static void putPolygons(
+            QByteArray& data, const QVector<QPolygonF>& polygon_list) {
+        put<quint32>(data, polygon_list.size());
+        for (const QPolygonF& polygon : polygon_list) {
+            put<quint32>(data, polygon.size());
+            put(data, polygon.constData(), polygon.size() * sizeof(QPointF));
+        }
+    }
+
+    static bool readPolygons(
+            Reader& reader, QVector<QPolygonF>& polygon_list) {
+        quint32 polygon_count = 0;
+        if (!reader.get(polygon_count)) {
+            return false;
+        }
+        for (quint32 i = 0; i < polygon_count; ++i) {
+            quint32 vertex_count = 0;
+            if (!reader.get(vertex_count) ||
+                    quint64(reader.end - reader.pos) <
+                    quint64(vertex_count) * sizeof(QPointF)) {
+                return false;
+            }
+            QPolygonF polygon(vertex_count);
+            reader.get(polygon.data(), vertex_count * sizeof(QPointF));
+            polygon_list.push_back(std::move(polygon));
+        }
+        return true;
+    }
+
+    static bool readContent(
+            Reader& reader,
+            const QString& filename, const QByteArray& file_hash,
+            uint& width, uint& height,
+            QVector<MapRegion>& region_list,
+            QVector<MapPoint>& point_list) {
+        char magic[sizeof(MAGIC)];
+        quint32 version = 0;
+        qint64 size = 0;
+        qint64 modified = 0;
+        char hash[HASH_SIZE];
+        if (!reader.get(magic, sizeof(magic)) ||
+                memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+                !reader.get(version) || version != VERSION ||
+                !reader.get(size) || !reader.get(modified) ||
+                !reader.get(hash, HASH_SIZE)) {
+            return false;
+        }
+
+        QFileInfo info(filename);
+        if (info.size() != size ||
+                info.lastModified().toMSecsSinceEpoch() != modified ||
+                file_hash != QByteArray(hash, HASH_SIZE)) {
+            return false;
+        }
+
+        quint32 w = 0, h = 0;
+        if (!reader.get(w) || !reader.get(h)) {
+            return false;
+        }
+        width = w;
+        height = h;
+
+        quint32 region_count = 0;
+        if (!reader.get(region_count)) {
+            return false;
+        }
+        region_list.reserve(region_count);
+        for (quint32 i = 0; i < region_count; ++i) {
+            quint32 index = 0;
+            quint8 visited = 0;
+            QString name;
+            QString child_map;
+            qreal transform[6];
+            QVector<QPolygonF> polygon_list;
+            if (!reader.get(index) || !reader.get(visited) ||
+                    !reader.getString(name) || !reader.getString(child_map) ||
+                    !reader.get(transform, sizeof(transform)) ||
+                    !readPolygons(reader, polygon_list)) {
+                return false;
+            }
+
+            MapRegion region(index, name, visited != 0);
+            region.setChildMap(child_map, QTransform(
+                transform[0], transform[1], transform[2],
+                transform[3], transform[4], transform[5]));
+            for (QPolygonF& polygon : polygon_list) {
+                region.addPolygon(std::move(polygon));
+            }
+
+            // Levels keep the polygon count of the exact geometry
+            for (int level = 1; level < MapRegion::LEVEL_COUNT; ++level) {
+                QVector<QPolygonF> level_list;
+                if (!readPolygons(reader, level_list) ||
+                        level_list.size() != region.getPolygonList().size()) {
+                    return false;
+                }
+                region.addLevel(std::move(level_list));
+            }
+            region_list.push_back(std::move(region));
+        }
+
+        quint32 point_count = 0;
+        if (!reader.get(point_count)) {
+            return false;
+        }
+        point_list.reserve(point_count);
+        for (quint32 i = 0; i < point_count; ++i) {
+            qreal x = 0, y = 0;
+            QString name;
+            QString photos;
+            if (!reader.get(x) || !reader.get(y) ||
+                    !reader.getString(name) || !reader.getString(photos)) {
+                return false;
+            }
+            point_list.emplace_back(QPointF(x, y), name);
+            point_list.back().setPhotoList(photos);
+        }
+
+        return reader.pos == reader.end;
+    }
+};
+
+#endif // MAPCACHE_H
@@ -0,0 +1,124 @@
+#ifndef MAPCATALOG_H
+#define MAPCATALOG_H
+
+#include "mapcache.h"
+#include "mapfile.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QSize>
+#include <QVector>
+
+#define MAP_DATA_PATH "data"
+#define MAP_BASE_SUFFIX "-base"
+
+// Maps found in the data directory. A map ships as <name>-base.svg and
+// is saved as <name>.svg once it has been changed. Scanning only lists
+// the directory, the metadata of a map is read when it is first asked
+// for, and the geometry is parsed only when the map is opened.
+class MapCatalog {
+public:
+    struct Info {
+        QSize size;
+        int regionCount; // -1 if unknown
+    };
+
+    struct Entry {
+        QString name; // Also prefixes the legacy photos of the map
+        QString title;
+        QString filePath;
+        QString baseFilePath;
+    };
+
+    void scan() {
+        m_entries.clear();
+        m_info.clear();
+
+        auto execPath = QCoreApplication::applicationDirPath();
+        QDir dir(QDir::cleanPath(
+            execPath + QDir::separator() + MAP_DATA_PATH));
+        auto file_list = dir.entryList(
+            QStringList("*.svg"), QDir::Files, QDir::Name);
+        for (const QString& filename : file_list) {
+            QString name = QFileInfo(filename).completeBaseName();
+            if (name.endsWith(MAP_BASE_SUFFIX)) {
+                name.chop(qstrlen(MAP_BASE_SUFFIX));
+            }
+            if (name.isEmpty() || indexOf(name) >= 0) {
+                continue;
+            }
+
+            m_entries.push_back({
+                name, makeTitle(name),
+                dir.filePath(name + ".svg"),
+                dir.filePath(name + MAP_BASE_SUFFIX + ".svg")});
+        }
+        m_info.fill({QSize(), UNREAD}, m_entries.size());
+    }
+
+    int size() const {
+        return m_entries.size();
+    }
+
+    const Entry& getEntry(int index) const {
+        Q_ASSERT(index >= 0 && index < m_entries.size());
+        return m_entries[index];
+    }
+
+    int indexOf(const QString& name) const {
+        for (int i = 0; i < m_entries.size(); ++i) {
+            if (m_entries[i].name == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // The saved map if there is one, the base map otherwise
+    QString getSourceFilePath(int index) const {
+        const Entry& entry = getEntry(index);
+        if (QFileInfo::exists(entry.filePath)) {
+            return entry.filePath;
+        }
+        return entry.baseFilePath;
+    }
+
+    // Reads the root element of the svg and the header of its cache.
+    // Without a cache the region paths are counted, but not parsed.
+    const Info& getInfo(int index) const {
+        Q_ASSERT(index >= 0 && index < m_info.size());
+        Info& info = m_info[index];
+        if (info.regionCount == UNREAD) {
+            QString filePath = getSourceFilePath(index);
+            uint width = 0, height = 0;
+            if (MapFile::readSize(filePath, width, height)) {
+                info.size = QSize(width, height);
+            }
+            info.regionCount = MapCache::readRegionCount(filePath);
+            if (info.regionCount < 0) {
+                info.regionCount = MapFile::countRegions(filePath);
+            }
+        }
+        return info;
+    }
+
+private:
+    static constexpr int UNREAD = -2;
+
+    // E.g. "south-america" becomes "South America"
+    static QString makeTitle(const QString& name) {
+        QStringList word_list =
+            QString(name).replace('_', '-').split('-', Qt::SkipEmptyParts);
+        for (QString& word : word_list) {
+            word[0] = word[0].toUpper();
+        }
+        return word_list.join(' ');
+    }
+
+private:
+    QVector<Entry> m_entries; // By name
+    mutable QVector<Info> m_info; // Follows the entries
+};
+
+#endif // MAPCATALOG_H
@@ -0,0 +1,523 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include "mappoint.h"
+#include "mapregion.h"
+#include "pathparser.h"
+
+#include <QFile>
+#include <QLocale>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QVector>
+#include <QXmlStreamReader>
+#include <QtConcurrent>
+
+// Streaming reader and writer of map svg files.
+// The first group of the document holds region paths, the second one
+// holds point circles. A region path may name its detail map in the
+// data-map attribute, together with the affine transform from the detail
+// map into this one as "a b c d e f" (like an svg matrix) in the
+// data-map-transform attribute. Loading streams the file into the plain model
+// without building a DOM, path geometry is parsed in parallel once all
+// paths are collected. Storing copies the source file through and
+// patches only the fill attributes, titles and circles that differ
+// from the model.
+class MapFile {
+public:
+    static bool load(
+            const QString& filename,
+            uint& width, uint& height,
+            QVector<MapRegion>& region_list,
+            QVector<MapPoint>& point_list) {
+        QFile file(filename);
+        if (!file.open(QFile::ReadOnly)) {
+            return false;
+        }
+
+        QXmlStreamReader reader(&file);
+        if (!reader.readNextStartElement() || reader.name() != u"svg") {
+            return false;
+        }
+
+        auto attributes = reader.attributes();
+        bool ok_width = false, ok_height = false;
+        width = attributes.value("width").toUInt(&ok_width);
+        height = attributes.value("height").toUInt(&ok_height);
+        if (!ok_width || !ok_height || width == 0 || height == 0) {
+            return false;
+        }
+
+        int group = 0;
+        bool ok = true;
+        while (ok && reader.readNextStartElement()) {
+            if (reader.name() == u"g" && group == 0) {
+                readRegions(reader, region_list);
+                ++group;
+            } else if (reader.name() == u"g" && group == 1) {
+                ok = readPoints(reader, point_list);
+                ++group;
+            } else {
+                reader.skipCurrentElement();
+            }
+        }
+
+        return ok && !reader.hasError() && group == 2;
+    }
+
+    // Reads the root element only
+    static bool readSize(const QString& filename, uint& width, uint& height) {
+        QFile file(filename);
+        if (!file.open(QFile::ReadOnly)) {
+            return false;
+        }
+
+        QXmlStreamReader reader(&file);
+        if (!reader.readNextStartElement() || reader.name() != u"svg") {
+            return false;
+        }
+
+        auto attributes = reader.attributes();
+        bool ok_width = false, ok_height = false;
+        width = attributes.value("width").toUInt(&ok_width);
+        height = attributes.value("height").toUInt(&ok_height);
+        return ok_width && ok_height;
+    }
+
+    // Counts the paths of the region group without parsing their data,
+    // or returns -1
+    static int countRegions(const QString& filename) {
+        QFile file(filename);
+        if (!file.open(QFile::ReadOnly)) {
+            return -1;
+        }
+
+        QXmlStreamReader reader(&file);
+        if (!reader.readNextStartElement() || reader.name() != u"svg") {
+            return -1;
+        }
+
+        while (reader.readNextStartElement()) {
+            if (reader.name() != u"g") {
+                reader.skipCurrentElement();
+                continue;
+            }
+
+            int count = 0;
+            while (reader.readNextStartElement()) {
+                if (reader.name() == u"path") {
+                    ++count;
+                }
+                reader.skipCurrentElement();
+            }
+            return reader.hasError() ? -1 : count;
+        }
+        return -1;
+    }
+
+    // Geographic bounds of the map as "west south east north" in the
+    // data-bounds attribute of the root element, in degrees
+    static bool readBounds(const QString& filename, QRectF& bounds) {
+        QFile file(filename);
+        if (!file.open(QFile::ReadOnly)) {
+            return false;
+        }
+
+        QXmlStreamReader reader(&file);
+        if (!reader.readNextStartElement() || reader.name() != u"svg") {
+            return false;
+        }
+
+        auto value_list = reader.attributes().value("data-bounds")
+            .split(u' ', Qt::SkipEmptyParts);
+        if (value_list.size() != 4) {
+            return false;
+        }
+
+        qreal value[4];
+        for (int i = 0; i < 4; ++i) {
+            bool ok = false;
+            value[i] = value_list[i].toDouble(&ok);
+            if (!ok) {
+                return false;
+            }
+        }
+        bounds = QRectF(
+            QPointF(value[0], value[1]), QPointF(value[2], value[3]));
+        return bounds.width() > 0 && bounds.height() > 0;
+    }
+
+    static bool store(
+            const QString& source, const QString& target,
+            float pointRadius,
+            const QVector<MapRegion>& region_list,
+            const QVector<MapPoint>& point_list) {
+        QFile input(source);
+        if (!input.open(QFile::ReadOnly)) {
+            return false;
+        }
+        QString content = QString::fromUtf8(input.readAll());
+        input.close();
+
+        QVector<Patch> patches;
+        if (!makePatches(
+                content, pointRadius, region_list, point_list, patches)) {
+            return false;
+        }
+
+        QString result;
+        result.reserve(content.size() + 64 * patches.size());
+        qsizetype copied = 0;
+        for (const Patch& patch : patches) {
+            Q_ASSERT(patch.from >= copied);
+            result += QStringView(content).mid(copied, patch.from - copied);
+            result += patch.text;
+            copied = patch.to;
+        }
+        result += QStringView(content).mid(copied);
+
+        // Written to a temporary file that atomically replaces the target
+        QSaveFile output(target);
+        if (!output.open(QFile::WriteOnly)) {
+            return false;
+        }
+        output.write(result.toUtf8());
+        return output.commit();
+    }
+
+private:
+    // Replaces content[from, to) with text
+    struct Patch {
+        qsizetype from;
+        qsizetype to;
+        QString text;
+    };
+
+    struct Circle {
+        QPointF point;
+        QString name;
+        QString photos;
+    };
+
+    struct Path {
+        int index;
+        QString name;
+        bool visited;
+        QString data;
+        QString childMap;
+        QString childTransform;
+    };
+
+    static void readRegions(
+            QXmlStreamReader& reader,
+            QVector<MapRegion>& region_list) {
+        QVector<Path> path_list;
+        int index = 0;
+        while (reader.readNextStartElement()) {
+            if (reader.name() != u"path") {
+                reader.skipCurrentElement();
+                continue;
+            }
+
+            auto attributes = reader.attributes();
+            Path path{
+                index,
+                attributes.value("name").toString(),
+                attributes.hasAttribute("fill"),
+                attributes.value("d").toString(),
+                attributes.value("data-map").toString(),
+                attributes.value("data-map-transform").toString()};
+
+            bool first = true;
+            while (reader.readNextStartElement()) {
+                if (first && reader.name() == u"title") {
+                    path.name = reader.readElementText();
+                } else {
+                    reader.skipCurrentElement();
+                }
+                first = false;
+            }
+
+            path_list.push_back(std::move(path));
+            ++index;
+        }
+
+        // Results keep the document order
+        QVector<MapRegion> parsed_list =
+            QtConcurrent::blockingMapped<QVector<MapRegion>>(
+                path_list, [](const Path& path) {
+                    thread_local PathParser parser;
+                    MapRegion region(path.index, path.name, path.visited);
+                    // A link without a transform can't be drawn in place
+                    QTransform transform;
+                    if (!path.childMap.isEmpty() &&
+                            readTransform(path.childTransform, transform)) {
+                        region.setChildMap(path.childMap, transform);
+                    }
+                    parser.parse(path.data, region);
+                    return region;
+                });
+
+        region_list.reserve(region_list.size() + parsed_list.size());
+        for (MapRegion& region : parsed_list) {
+            if (!region.getPolygonList().isEmpty()) {
+                region_list.push_back(std::move(region));
+            }
+        }
+    }
+
+    static bool readTransform(const QString& text, QTransform& transform) {
+        auto value_list = QStringView(text).split(u' ', Qt::SkipEmptyParts);
+        if (value_list.size() != 6) {
+            return false;
+        }
+
+        qreal value[6];
+        for (int i = 0; i < 6; ++i) {
+            bool ok = false;
+            value[i] = value_list[i].toDouble(&ok);
+            if (!ok) {
+                return false;
+            }
+        }
+        transform = QTransform(
+            value[0], value[1], value[2], value[3], value[4], value[5]);
+        return transform.isInvertible();
+    }
+
+    static bool readPoints(
+            QXmlStreamReader& reader,
+            QVector<MapPoint>& point_list) {
+        while (reader.readNextStartElement()) {
+            if (reader.name() != u"circle") {
+                reader.skipCurrentElement();
+                continue;
+            }
+
+            Circle circle;
+            if (!readCircle(reader, circle)) {
+                return false;
+            }
+            point_list.emplace_back(circle.point, circle.name);
+            point_list.back().setPhotoList(circle.photos);
+        }
+        return true;
+    }
+
+    static bool readCircle(QXmlStreamReader& reader, Circle& circle) {
+        auto attributes = reader.attributes();
+        bool ok_x = false, ok_y = false;
+        float x = attributes.value("cx").toFloat(&ok_x);
+        float y = attributes.value("cy").toFloat(&ok_y);
+        if (!ok_x || !ok_y) {
+            return false;
+        }
+
+        QString photos = attributes.value("data-photo").toString();
+
+        QString name("");
+        bool first = true;
+        while (reader.readNextStartElement()) {
+            if (first && reader.name() == u"title") {
+                name = reader.readElementText();
+            } else {
+                reader.skipCurrentElement();
+            }
+            first = false;
+        }
+
+        circle = {QPointF(x, y), name, photos};
+        return true;
+    }
+
+    // Walks the document keeping track of character offsets, so that
+    // patches can refer to exact spans of the original text. Offsets are
+    // taken right after start and end tags, the beginning of a tag is
+    // then found as the preceding '<'.
+    static bool makePatches(
+            const QString& content,
+            float pointRadius,
+            const QVector<MapRegion>& region_list,
+            const QVector<MapPoint>& point_list,
+            QVector<Patch>& patches) {
+        QXmlStreamReader reader(content);
+        if (!reader.readNextStartElement() || reader.name() != u"svg") {
+            return false;
+        }
+
+        int group = 0;
+        while (reader.readNextStartElement()) {
+            if (reader.name() == u"g" && group == 0) {
+                patchRegions(reader, content, region_list, patches);
+                ++group;
+            } else if (reader.name() == u"g" && group == 1) {
+                patchPoints(
+                    reader, content, pointRadius, point_list, patches);
+                ++group;
+            } else {
+                reader.skipCurrentElement();
+            }
+        }
+
+        Q_ASSERT(!reader.hasError());
+        return !reader.hasError() && group == 2;
+    }
+
+    static qsizetype tagStart(const QString& content, qsizetype tag_end) {
+        Q_ASSERT(tag_end > 0 && content[tag_end - 1] == u'>');
+        qsizetype i = content.lastIndexOf(u'<', tag_end - 1);
+        Q_ASSERT(i >= 0);
+        return i;
+    }
+
+    static void patchRegions(
+            QXmlStreamReader& reader,
+            const QString& content,
+            const QVector<MapRegion>& region_list,
+            QVector<Patch>& patches) {
+        int index = 0;
+        auto region = region_list.cbegin();
+        while (reader.readNextStartElement()) {
+            if (reader.name() != u"path") {
+                reader.skipCurrentElement();
+                continue;
+            }
+
+            qsizetype tag_end = reader.characterOffset();
+            qsizetype tag_start = tagStart(content, tag_end);
+            auto attributes = reader.attributes();
+            bool visited = attributes.hasAttribute("fill");
+            QString name = attributes.value("name").toString();
+
+            // The title is expected to be the first child element
+            qsizetype title_start = -1;
+            qsizetype title_end = -1;
+            bool first = true;
+            while (reader.readNextStartElement()) {
+                if (first && reader.name() == u"title") {
+                    title_start = tagStart(content, reader.characterOffset());
+                    name = reader.readElementText();
+                    title_end = reader.characterOffset();
+                } else {
+                    reader.skipCurrentElement();
+                }
+                first = false;
+            }
+
+            bool matches =
+                region != region_list.cend() && region->getIndex() == index;
+            if (matches && (visited != region->isVisited() ||
+                            name != region->getName())) {
+                QString tag = content.mid(tag_start, tag_end - tag_start);
+                if (visited != region->isVisited()) {
+                    tag = patchFill(tag, region->isVisited());
+                }
+
+                QString title;
+                if (name != region->getName()) {
+                    title = makeTitle(region->getName());
+                }
+
+                if (title.isEmpty() || title_start >= 0) {
+                    patches.push_back({tag_start, tag_end, tag});
+                    if (!title.isEmpty()) {
+                        patches.push_back({title_start, title_end, title});
+                    }
+                } else if (tag.endsWith("/>")) {
+                    tag.chop(2);
+                    patches.push_back(
+                        {tag_start, tag_end, tag + ">" + title + "</path>"});
+                } else {
+                    patches.push_back({tag_start, tag_end, tag + title});
+                }
+            }
+
+            if (matches) {
+                ++region;
+            }
+            ++index;
+        }
+    }
+
+    static void patchPoints(
+            QXmlStreamReader& reader,
+            const QString& content,
+            float pointRadius,
+            const QVector<MapPoint>& point_list,
+            QVector<Patch>& patches) {
+        qsizetype content_start = reader.characterOffset();
+        qsizetype group_start = tagStart(content, content_start);
+        QString tag = content.mid(group_start, content_start - group_start);
+
+        QVector<Circle> circle_list;
+        while (reader.readNextStartElement()) {
+            if (reader.name() == u"circle") {
+                // A malformed circle just differs from the model
+                Circle circle;
+                readCircle(reader, circle);
+                circle_list.push_back(circle);
+            } else {
+                reader.skipCurrentElement();
+            }
+        }
+
+        // Coordinates are stored with float precision
+        bool same = circle_list.size() == point_list.size();
+        for (int i = 0; same && i < point_list.size(); ++i) {
+            const QPointF& point = point_list[i].getPoint();
+            same = circle_list[i].point.x() == float(point.x()) &&
+                circle_list[i].point.y() == float(point.y()) &&
+                circle_list[i].name == point_list[i].getName() &&
+                circle_list[i].photos == point_list[i].getPhotoList();
+        }
+        if (same) {
+            return;
+        }
+
+        QString circles;
+        for (const MapPoint& point : point_list) {
+            circles += "\n  <circle cx=\"" + number(point.getPoint().x()) +
+                "\" cy=\"" + number(point.getPoint().y()) +
+                "\" r=\"" + number(pointRadius) + "\"";
+            if (!point.getPhotos().isEmpty()) {
+                circles += " data-photo=\"" +
+                    point.getPhotoList().toHtmlEscaped() + "\"";
+            }
+            circles += ">" + makeTitle(point.getName()) + "</circle>";
+        }
+        circles += "\n ";
+
+        if (tag.endsWith("/>")) {
+            tag.chop(2);
+            patches.push_back(
+                {group_start, content_start, tag + ">" + circles + "</g>"});
+        } else {
+            qsizetype content_end = tagStart(content, reader.characterOffset());
+            patches.push_back({content_start, content_end, circles});
+        }
+    }
+
+    static QString patchFill(QString tag, bool visited) {
+        if (visited) {
+            // Right after the element name
+            int i = tag.indexOf(QRegularExpression("[\\s/>]"), 1);
+            Q_ASSERT(i > 0);
+            tag.insert(i, " fill=\"#90ee90\"");
+        } else {
+            static const QRegularExpression fill(
+                "\\s+fill\\s*=\\s*(\"[^\"]*\"|'[^']*')");
+            tag.remove(fill);
+        }
+        return tag;
+    }
+
+    static QString makeTitle(const QString& name) {
+        return "<title>" + name.toHtmlEscaped() + "</title>";
+    }
+
+    static QString number(qreal value) {
+        return QString::number(value, 'g', QLocale::FloatingPointShortest);
+    }
+};
+
+#endif // MAPFILE_H
@@ -0,0 +1,176 @@
+#ifndef MAPJOURNAL_H
+#define MAPJOURNAL_H
+
+#include <QFile>
+#include <QLocale>
+#include <QPointF>
+#include <QStringList>
+#include <QUrl>
+#include <QVector>
+
+// Append-only journal of map changes, stored next to the svg as
+// <svg>.journal. The header holds the hash of the svg the journal
+// applies to, so a journal left behind by an interrupted compaction, or
+// by an svg changed outside the app, is recognized as stale and has to be
+// removed before anything is appended. Every entry is a single line; a
+// torn last line is dropped on read.
+class MapJournal {
+public:
+    enum Type {
+        RegionVisited,
+        RegionName,
+        PointAdded,
+        PointName,
+        PointPhotos,
+        PointRemoved
+    };
+
+    struct Entry {
+        Type type;
+        int id; // Region index or point id
+        bool visited;
+        QPointF point;
+        QString name; // Or the photo keys
+    };
+
+    static QString getJournalFilename(const QString& filename) {
+        return filename + ".journal";
+    }
+
+    static QByteArray regionVisited(int index, bool visited) {
+        return "visited " + QByteArray::number(index) +
+            (visited ? " 1" : " 0");
+    }
+
+    static QByteArray regionName(int index, const QString& name) {
+        return "name " + QByteArray::number(index) + " " + encode(name);
+    }
+
+    static QByteArray pointAdded(int id, QPointF point, const QString& name) {
+        return "add " + QByteArray::number(id) + " " +
+            number(point.x()) + " " + number(point.y()) + " " + encode(name);
+    }
+
+    static QByteArray pointName(int id, const QString& name) {
+        return "rename " + QByteArray::number(id) + " " + encode(name);
+    }
+
+    // The photo keys of the point, space separated
+    static QByteArray pointPhotos(int id, const QString& photos) {
+        return "photo " + QByteArray::number(id) + " " + encode(photos);
+    }
+
+    static QByteArray pointRemoved(int id) {
+        return "remove " + QByteArray::number(id);
+    }
+
+    // Reads the entries that apply to the current content of the svg.
+    // Returns false if the journal is stale.
+    static bool read(
+            const QString& filename, const QByteArray& hash,
+            QVector<Entry>& entry_list) {
+        QFile file(getJournalFilename(filename));
+        if (!file.open(QFile::ReadOnly)) {
+            return true;
+        }
+        QByteArray data = file.readAll();
+        file.close();
+
+        QList<QByteArray> line_list = data.split('\n');
+        line_list.removeLast(); // Empty or torn
+        if (line_list.isEmpty() ||
+                line_list.front() != header(hash)) {
+            return false;
+        }
+
+        for (int i = 1; i < line_list.size(); ++i) {
+            Entry entry;
+            if (parse(line_list[i], entry)) {
+                entry_list.push_back(entry);
+            }
+        }
+        return true;
+    }
+
+    // The hash of the svg is only written into the header of a new journal
+    static bool append(
+            const QString& filename, const QByteArray& hash,
+            const QList<QByteArray>& entry_list) {
+        QFile file(getJournalFilename(filename));
+        if (!file.open(QFile::WriteOnly | QFile::Append)) {
+            return false;
+        }
+
+        QByteArray data;
+        if (file.size() == 0) {
+            data += header(hash) + '\n';
+        }
+        for (const QByteArray& entry : entry_list) {
+            data += entry + '\n';
+        }
+
+        bool ok = file.write(data) == data.size() && file.flush();
+        file.close();
+        return ok;
+    }
+
+    static void remove(const QString& filename) {
+        QFile::remove(getJournalFilename(filename));
+    }
+
+private:
+    static QByteArray header(const QByteArray& hash) {
+        return "traveler-journal 1 " + hash.toHex();
+    }
+
+    static QByteArray encode(const QString& name) {
+        return QUrl::toPercentEncoding(name);
+    }
+
+    static QByteArray number(qreal value) {
+        return QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+    }
+
+    static bool parse(const QByteArray& line, Entry& entry) {
+        QList<QByteArray> field_list = line.split(' ');
+        if (field_list.size() < 2) {
+            return false;
+        }
+
+        bool ok = false;
+        entry.id = field_list[1].toInt(&ok);
+        if (!ok) {
+            return false;
+        }
+
+        const QByteArray& type = field_list[0];
+        if (type == "visited" && field_list.size() == 3) {
+            entry.type = RegionVisited;
+            entry.visited = field_list[2] == "1";
+        } else if (type == "name" && field_list.size() == 3) {
+            entry.type = RegionName;
+            entry.name = QUrl::fromPercentEncoding(field_list[2]);
+        } else if (type == "add" && field_list.size() == 5) {
+            bool ok_x = false, ok_y = false;
+            entry.type = PointAdded;
+            entry.point = QPointF(
+                field_list[2].toDouble(&ok_x),
+                field_list[3].toDouble(&ok_y));
+            entry.name = QUrl::fromPercentEncoding(field_list[4]);
+            ok = ok_x && ok_y;
+        } else if (type == "rename" && field_list.size() == 3) {
+            entry.type = PointName;
+            entry.name = QUrl::fromPercentEncoding(field_list[2]);
+        } else if (type == "photo" && field_list.size() == 3) {
+            entry.type = PointPhotos;
+            entry.name = QUrl::fromPercentEncoding(field_list[2]);
+        } else if (type == "remove" && field_list.size() == 2) {
+            entry.type = PointRemoved;
+        } else {
+            ok = false;
+        }
+        return ok;
+    }
+};
+
+#endif // MAPJOURNAL_H
@@ -0,0 +1,268 @@
+#include "maplayeritem.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "trace.h"
+
+// Public Methods
+
+MapLayerItem::MapLayerItem(const MapObject* map, MapTileCache* tiles)
+        : m_map(map), m_rect(QPointF(0, 0), map->getSize()), m_level(0),
+          m_interactive(false), m_tiles(tiles),
+          m_tileLayer(tiles->addLayer()) {
+    Q_ASSERT(m_map != nullptr);
+    setCacheMode(DeviceCoordinateCache);
+    setFlag(ItemUsesExtendedStyleOption);
+
+    const QVector<MapRegion>& region_list = m_map->getRegionList();
+    m_states.reserve(region_list.size());
+    m_regionRects.reserve(region_list.size());
+    for (const MapRegion& region : region_list) {
+        m_states.push_back(getState(m_states.size()));
+
+        // Outlines are stroked half the pen width beyond the polygons
+        QRectF rect;
+        for (const QPolygonF& polygon : region.getPolygonList()) {
+            rect |= polygon.boundingRect();
+        }
+        qreal margin = getPen().widthF();
+        m_regionRects.push_back(rect.adjusted(-margin, -margin, margin, margin));
+    }
+
+    for (int state = 0; state < StateCount; ++state) {
+        m_dirty[state] = true;
+    }
+
+    m_tileConnection = QObject::connect(
+        m_tiles, &MapTileCache::tileRendered,
+        m_tiles, [this](int layer, const QRectF& rect) {
+            if (layer == m_tileLayer && m_interactive) {
+                update(rect);
+            }
+        });
+}
+
+MapLayerItem::~MapLayerItem() {
+    QObject::disconnect(m_tileConnection);
+    m_tiles->removeLayer(m_tileLayer);
+}
+
+QRectF MapLayerItem::boundingRect() const {
+    return m_rect;
+}
+
+// Tiles of the exposed area are requested in any mode, so that they are
+// mostly ready by the time the view is moved
+void MapLayerItem::paint(
+        QPainter *painter,
+        const QStyleOptionGraphicsItem *option,
+        QWidget *widget) {
+    Q_UNUSED(widget);
+    TRACE_SCOPE("MapLayerItem::paint");
+
+    qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
+    int zoom = MapTileCache::getZoom(scale);
+    const auto tile_list =
+        MapTileCache::getTiles(zoom, option->exposedRect & m_rect);
+
+    if (!m_interactive) {
+        drawPaths(painter);
+        for (const MapTileCache::Tile& tile : tile_list) {
+            requestTile(tile);
+        }
+        return;
+    }
+
+    QPainterPath missing;
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    for (const MapTileCache::Tile& tile : tile_list) {
+        const QImage* image = m_tiles->find(m_tileLayer, tile);
+        if (image != nullptr) {
+            painter->drawImage(MapTileCache::getTileRect(tile), *image);
+        } else {
+            requestTile(tile);
+            missing.addRect(MapTileCache::getTileRect(tile));
+        }
+    }
+    painter->restore();
+
+    if (!missing.isEmpty()) {
+        painter->save();
+        painter->setClipPath(missing, Qt::IntersectClip);
+        drawPaths(painter);
+        painter->restore();
+    }
+}
+
+int MapLayerItem::getLevel() const {
+    return m_level;
+}
+
+void MapLayerItem::setLevel(int level) {
+    if (level == m_level) {
+        return;
+    }
+
+    m_level = level;
+    for (int state = 0; state < StateCount; ++state) {
+        m_dirty[state] = true;
+    }
+    update();
+}
+
+bool MapLayerItem::isInteractive() const {
+    return m_interactive;
+}
+
+// Leaving the interactive mode repaints the layer from the paths
+void MapLayerItem::setInteractive(bool interactive) {
+    if (interactive == m_interactive) {
+        return;
+    }
+
+    m_interactive = interactive;
+    if (!m_interactive) {
+        update();
+    }
+}
+
+QRectF MapLayerItem::getRegionRect(const MapRegion* region) const {
+    return m_regionRects[getId(region)];
+}
+
+// Repaints the region if its fill state has changed
+void MapLayerItem::updateRegion(const MapRegion* region) {
+    int id = getId(region);
+    State state = getState(id);
+    if (state == m_states[id]) {
+        return;
+    }
+
+    // The region is appended to the path of its new state, only the path
+    // it leaves has to be built again
+    m_dirty[m_states[id]] = true;
+    if (!m_dirty[state]) {
+        addRegion(m_paths[state], id);
+    }
+    m_states[id] = state;
+    m_tiles->invalidate(m_tileLayer, m_regionRects[id]);
+    update(m_regionRects[id]);
+}
+
+// Private Methods
+
+MapLayerItem::State MapLayerItem::getState(int id) const {
+    const MapRegion& region = m_map->getRegionList()[id];
+    if (region.isChecked()) {
+        return Checked;
+    }
+    if (region.isShownVisited()) {
+        return Visited;
+    }
+    return Normal;
+}
+
+int MapLayerItem::getId(const MapRegion* region) const {
+    Q_ASSERT(region != nullptr);
+    int id = region - m_map->getRegionList().constData();
+    Q_ASSERT(id >= 0 && id < m_states.size());
+    return id;
+}
+
+QPen MapLayerItem::getPen() {
+    return QPen(QBrush(QColorConstants::Black), 0.25f);
+}
+
+QColor MapLayerItem::getColor(State state) {
+    switch (state) {
+    case Checked:
+        return QColorConstants::Svg::lightyellow;
+    case Visited:
+        return QColorConstants::Svg::lightgreen;
+    default:
+        return QColorConstants::Svg::lightgray;
+    }
+}
+
+// Runs on a worker thread. The region geometry doesn't change after the
+// map is loaded, the states are a snapshot taken at request time.
+QImage MapLayerItem::renderTile(
+        const QVector<MapRegion>* region_list,
+        QVector<QRectF> rect_list,
+        QVector<State> state_list,
+        const MapTileCache::Tile& tile) {
+    TRACE_SCOPE("MapLayerItem::renderTile");
+    QImage image(
+        MapTileCache::TILE_SIZE, MapTileCache::TILE_SIZE,
+        QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QRectF rect = MapTileCache::getTileRect(tile);
+    qreal scale = MapTileCache::getScale(tile.zoom);
+    int level = MapRegion::getLevel(scale);
+
+    QPainter painter(&image);
+    painter.scale(scale, scale);
+    painter.translate(-rect.topLeft());
+    painter.setPen(getPen());
+    for (int state = 0; state < StateCount; ++state) {
+        painter.setBrush(getColor(static_cast<State>(state)));
+        for (int i = 0; i < region_list->size(); ++i) {
+            if (state_list[i] != state || !rect_list[i].intersects(rect)) {
+                continue;
+            }
+            for (const QPolygonF& polygon : (*region_list)[i].getPolygonList(level)) {
+                painter.drawPolygon(polygon);
+            }
+        }
+    }
+    painter.end();
+
+    return image;
+}
+
+// Overlapping regions of the same state must not cancel each other out
+void MapLayerItem::buildPath(State state) {
+    QPainterPath path;
+    path.setFillRule(Qt::WindingFill);
+    for (int i = 0; i < m_states.size(); ++i) {
+        if (m_states[i] == state) {
+            addRegion(path, i);
+        }
+    }
+
+    m_paths[state] = path;
+    m_dirty[state] = false;
+}
+
+void MapLayerItem::addRegion(QPainterPath& path, int id) const {
+    const MapRegion& region = m_map->getRegionList()[id];
+    for (const QPolygonF& polygon : region.getPolygonList(m_level)) {
+        path.addPolygon(polygon);
+        path.closeSubpath();
+    }
+}
+
+void MapLayerItem::drawPaths(QPainter* painter) {
+    painter->setPen(getPen());
+    for (int state = 0; state < StateCount; ++state) {
+        if (m_dirty[state]) {
+            buildPath(static_cast<State>(state));
+        }
+        painter->setBrush(getColor(static_cast<State>(state)));
+        painter->drawPath(m_paths[state]);
+    }
+}
+
+void MapLayerItem::requestTile(const MapTileCache::Tile& tile) {
+    const QVector<MapRegion>* region_list = &m_map->getRegionList();
+    QVector<QRectF> rect_list = m_regionRects;
+    QVector<State> state_list = m_states;
+    m_tiles->request(
+        m_tileLayer, tile, [region_list, rect_list, state_list, tile]() {
+            return renderTile(region_list, rect_list, state_list, tile);
+        });
+}
@@ -0,0 +1,77 @@
+#ifndef MAPLAYERITEM_H
+#define MAPLAYERITEM_H
+
+#include <QGraphicsItem>
+#include <QPainterPath>
+#include <QVector>
+
+#include "MapObject.h"
+#include "maptilecache.h"
+
+// Paints all regions of a map as a single item. Regions are batched into
+// one path per fill state, so a repaint costs a few path fills instead of
+// walking an item per polygon. The item is cached in device coordinates,
+// and a state change only invalidates the bounding rect of its region.
+// While the view is being panned or zoomed, the layer blits raster tiles
+// and falls back to the paths only where tiles aren't rendered yet. The
+// tile cache is shared with the other layers of the view.
+class MapLayerItem : public QGraphicsItem {
+public:
+    MapLayerItem(const MapObject* map, MapTileCache* tiles);
+    ~MapLayerItem();
+
+    QRectF boundingRect() const override;
+    void paint(
+            QPainter *painter,
+            const QStyleOptionGraphicsItem *option,
+            QWidget *widget) override;
+
+    int getLevel() const;
+    void setLevel(int level);
+
+    bool isInteractive() const;
+    void setInteractive(bool interactive);
+
+    QRectF getRegionRect(const MapRegion* region) const;
+    void updateRegion(const MapRegion* region);
+
+private:
+    enum State {
+        Normal,
+        Visited,
+        Checked,
+        StateCount
+    };
+
+    State getState(int id) const;
+    int getId(const MapRegion* region) const;
+    static QPen getPen();
+    static QColor getColor(State state);
+    static QImage renderTile(
+            const QVector<MapRegion>* region_list,
+            QVector<QRectF> rect_list,
+            QVector<State> state_list,
+            const MapTileCache::Tile& tile);
+
+    void buildPath(State state);
+    void addRegion(QPainterPath& path, int id) const;
+    void drawPaths(QPainter* painter);
+    void requestTile(const MapTileCache::Tile& tile);
+
+private:
+    const MapObject* m_map;
+    QRectF m_rect;
+    int m_level;
+    bool m_interactive;
+    MapTileCache* m_tiles;
+    int m_tileLayer; // Id of the layer in the tile cache
+    QMetaObject::Connection m_tileConnection;
+
+    QVector<State> m_states; // Follows the region list
+    QVector<QRectF> m_regionRects;
+
+    QPainterPath m_paths[StateCount];
+    bool m_dirty[StateCount];
+};
+
+#endif // MAPLAYERITEM_H
@@ -1,21 +1,18 @@
 #ifndef MAPPOINT_H
 #define MAPPOINT_H
 
-#include <QApplication>
+#include <QCoreApplication>
 #include <QDir>
-#include <QDomElement>
 #include <QFile>
 #include <QPointF>
+#include <QStringList>
 
 #define PHOTO_PATH "photo"
 
 class MapPoint {
 public:
-    MapPoint(
-        QDomDocument doc, QDomElement root, QDomElement element,
-        QPointF point, const QString& name)
-            : m_doc(doc), m_root(root), m_element(element),
-              m_point(point), m_name(name), m_checked(false) {}
+    MapPoint(QPointF point, const QString& name)
+            : m_point(point), m_name(name), m_checked(false), m_id(-1) {}
 
     const QPointF& getPoint() const {
         return m_point;
@@ -29,80 +26,64 @@ public:
         m_checked = checked;
     }
 
+    // Identifies the point in the map journal
+    int getId() const {
+        return m_id;
+    }
+
+    void setId(int id) {
+        m_id = id;
+    }
+
     const QString& getName() const {
         return m_name;
     }
 
-    void setName(const QString& name) {
-        m_name = name;
+    // Keys of the photos in the photo store, in display order
+    const QStringList& getPhotos() const {
+        return m_photos;
+    }
 
-        if (m_element.hasChildNodes()) {
-            QDomNode title_node = m_element.firstChild();
-            QDomElement title_element = title_node.toElement();
-
-            QDomElement new_title_element = m_doc.createElement("title");
-            QDomText title_text = m_doc.createTextNode(m_name);
-            new_title_element.appendChild(title_text);
-            m_element.replaceChild(new_title_element, title_element);
-        } else {
-            QDomElement title_element = m_doc.createElement("title");
-            QDomText title_text = m_doc.createTextNode(m_name);
-            title_element.appendChild(title_text);
-            m_element.appendChild(title_element);
-        }
+    // Photo keys have no spaces, so the list is saved space separated
+    QString getPhotoList() const {
+        return m_photos.join(' ');
     }
 
-    QString getPhotoFilename() const {
-        return
-                QString::number(qRound(m_point.x())) +
-                "_" +
-                QString::number(qRound(m_point.y())) +
-                ".jpg";
+    void setPhotoList(const QString& photos) {
+        m_photos = photos.split(' ', Qt::SkipEmptyParts);
     }
 
-    QString getPhotoFilePath(const QString& prefix) const {
+    // Photos used to be copied next to the executable under names made of
+    // the rounded coordinates. Such a photo is taken into the photo store
+    // once the point is saved.
+    QString getLegacyPhotoFilePath(const QString& prefix) const {
         auto execPath = QCoreApplication::applicationDirPath();
         return QDir::cleanPath(
                     execPath + QDir::separator() +
                     PHOTO_PATH + QDir::separator() +
-                    prefix + "_" + getPhotoFilename());
+                    prefix + "_" +
+                    QString::number(qRound(m_point.x())) + "_" +
+                    QString::number(qRound(m_point.y())) + ".jpg");
     }
 
-    void setPhoto(const QString& filename, const QString& prefix) {
-        auto target = getPhotoFilePath(prefix);
-        if (filename.isEmpty()) { // Remove photo
-            if (QFile::exists(target)) {
-                bool ok = QFile::remove(target);
-                Q_ASSERT(ok);
-            }
-        } else { // Save photo
-            if (filename != target) {
-                if (QFile::exists(target)) {
-                    bool ok = QFile::remove(target);
-                    Q_ASSERT(ok);
-                }
-                bool ok = QFile::copy(filename, target);
-                Q_ASSERT(ok);
-            }
-        }
-    }
+private:
+    // Goes through MapObject, which tracks the changes to save
+    friend class MapObject;
 
-    void remove() {
-        m_root.removeChild(m_element);
+    void setName(const QString& name) {
+        m_name = name;
     }
 
-    bool operator==(const MapPoint& right) const {
-        return m_point == right.m_point;
+    void setPhotos(const QStringList& photos) {
+        m_photos = photos;
     }
 
 private:
-    QDomDocument m_doc;
-    QDomElement m_root;
-    QDomElement m_element;
-
     QPointF m_point;
     QString m_name;
+    QStringList m_photos;
     bool m_checked;
+    int m_id;
 };
 
 #endif // MAPPOINT_H
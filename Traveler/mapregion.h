@@ -1,64 +1,127 @@
 #ifndef MAPREGION_H
 #define MAPREGION_H
 
-#include <QDomElement>
+#include "polygonsimplifier.h"
+
 #include <QPolygon>
 #include <QSize>
+#include <QTransform>
 #include <QVector>
 
+#include <utility>
+
 class MapRegion {
 public:
-    MapRegion(
-        QDomDocument doc, QDomElement element,
-        const QString& name, bool visited)
-            : m_doc(doc), m_element(element), m_name(name),
-              m_visited(visited), m_checked(false) {}
+    MapRegion(int index, const QString& name, bool visited)
+            : m_index(index), m_name(name),
+              m_visited(visited), m_childVisited(false), m_checked(false) {}
 
     void addPolygon(QPolygonF polygon) {
-        m_region.push_back(polygon);
+        m_region.push_back(std::move(polygon));
     }
 
     const QVector<QPolygonF>& getPolygonList() const {
         return m_region;
     }
 
-    const QString& getName() const {
-        return m_name;
+    // Same rule as the region index uses, on the exact geometry
+    bool contains(QPointF point) const {
+        for (const QPolygonF& polygon : m_region) {
+            if (polygon.containsPoint(point, Qt::OddEvenFill)) {
+                return true;
+            }
+        }
+        return false;
     }
 
-    void setName(const QString& name) {
-        m_name = name;
+    // Level 0 is the exact geometry, every further level doubles the
+    // tolerance of the simplification
+    static constexpr int LEVEL_COUNT = 6;
+
+    static qreal getLevelTolerance(int level) {
+        Q_ASSERT(level >= 0 && level < LEVEL_COUNT);
+        return level == 0 ? 0.0 : 0.25 * (1 << level);
+    }
 
-        if (m_element.hasChildNodes()) {
-            QDomNode title_node = m_element.firstChild();
-            QDomElement title_element = title_node.toElement();
-
-            QDomElement new_title_element = m_doc.createElement("title");
-            QDomText title_text = m_doc.createTextNode(m_name);
-            new_title_element.appendChild(title_text);
-            m_element.replaceChild(new_title_element, title_element);
-        } else {
-            QDomElement title_element = m_doc.createElement("title");
-            QDomText title_text = m_doc.createTextNode(m_name);
-            title_element.appendChild(title_text);
-            m_element.appendChild(title_element);
+    // Coarsest level whose error stays within half a pixel at the zoom
+    static int getLevel(qreal zoom) {
+        for (int level = LEVEL_COUNT - 1; level > 0; --level) {
+            if (getLevelTolerance(level) * zoom <= 0.5) {
+                return level;
+            }
         }
+        return 0;
     }
 
-    void setVisited(bool visited) {
-        m_visited = visited;
+    // Simplified polygons are meant for rendering only and keep the
+    // order and count of the exact ones
+    const QVector<QPolygonF>& getPolygonList(int level) const {
+        Q_ASSERT(level >= 0 && level < LEVEL_COUNT);
+        if (level == 0 || m_levels.isEmpty()) {
+            return m_region;
+        }
+        return m_levels[level - 1];
+    }
 
-        if (m_visited) {
-            m_element.setAttribute("fill", "#90ee90");
-        } else {
-            m_element.removeAttribute("fill");
+    void buildLevels() {
+        m_levels.clear();
+        m_levels.reserve(LEVEL_COUNT - 1);
+        for (int level = 1; level < LEVEL_COUNT; ++level) {
+            QVector<QPolygonF> polygon_list;
+            polygon_list.reserve(m_region.size());
+            for (const QPolygonF& polygon : m_region) {
+                polygon_list.push_back(PolygonSimplifier::simplify(
+                    polygon, getLevelTolerance(level)));
+            }
+            m_levels.push_back(std::move(polygon_list));
         }
     }
 
+    // Restores a level built before, levels are added from level 1 on
+    void addLevel(QVector<QPolygonF> polygon_list) {
+        Q_ASSERT(polygon_list.size() == m_region.size());
+        Q_ASSERT(m_levels.size() < LEVEL_COUNT - 1);
+        m_levels.push_back(std::move(polygon_list));
+    }
+
+    const QString& getName() const {
+        return m_name;
+    }
+
+    // Position of the region's path element in the document
+    int getIndex() const {
+        return m_index;
+    }
+
+    // Name of the detail map of the region in the map catalog, if any
+    const QString& getChildMap() const {
+        return m_childMap;
+    }
+
+    // Maps the detail map into the coordinates of this map
+    const QTransform& getChildTransform() const {
+        return m_childTransform;
+    }
+
+    void setChildMap(const QString& name, const QTransform& transform) {
+        m_childMap = name;
+        m_childTransform = transform;
+    }
+
     bool isVisited() const {
         return m_visited;
     }
 
+    // Some region of the detail map is visited. The view derives it from
+    // the detail map, it is shown but never saved with this map.
+    bool isChildVisited() const {
+        return m_childVisited;
+    }
+
+    bool isShownVisited() const {
+        return m_visited || m_childVisited;
+    }
+
     void setChecked(bool checked) {
         m_checked = checked;
     }
@@ -68,12 +131,32 @@ public:
     }
 
 private:
-    QDomDocument m_doc;
-    QDomElement m_element;
+    // Goes through MapObject, which keeps count of visited regions and
+    // tracks the changes to save
+    friend class MapObject;
+
+    void setVisited(bool visited) {
+        m_visited = visited;
+    }
+
+    void setChildVisited(bool visited) {
+        m_childVisited = visited;
+    }
+
+    void setName(const QString& name) {
+        m_name = name;
+    }
+
+private:
+    int m_index;
 
     QVector<QPolygonF> m_region;
+    QVector<QVector<QPolygonF>> m_levels;
     QString m_name;
+    QString m_childMap;
+    QTransform m_childTransform;
     bool m_visited;
+    bool m_childVisited;
     bool m_checked;
 };
 
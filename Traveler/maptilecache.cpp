@@ -0,0 +1,166 @@
+#include "maptilecache.h"
+
+#include <QtConcurrent>
+#include <QtMath>
+
+// Public Methods
+
+MapTileCache::MapTileCache(QObject *parent)
+        : QObject{parent}, m_tiles(DEFAULT_MEMORY_BUDGET),
+          m_serial(0), m_lastLayer(0) {}
+
+// Rendering tasks refer to map geometry, so they have to finish first
+MapTileCache::~MapTileCache() {
+    m_pool.waitForDone();
+}
+
+// Smallest zoom level that is at least as detailed as the scale
+int MapTileCache::getZoom(qreal scale) {
+    Q_ASSERT(scale > 0);
+    int zoom = qCeil(std::log2(scale) - 1e-6);
+    return qBound(MIN_ZOOM, zoom, MAX_ZOOM);
+}
+
+qreal MapTileCache::getScale(int zoom) {
+    return std::ldexp(1.0, zoom);
+}
+
+QRectF MapTileCache::getTileRect(const Tile& tile) {
+    qreal size = TILE_SIZE / getScale(tile.zoom);
+    return QRectF(tile.x * size, tile.y * size, size, size);
+}
+
+// Tiles covering the rect, which is expected to lie within the map
+QVector<MapTileCache::Tile> MapTileCache::getTiles(
+        int zoom, const QRectF& rect) {
+    QVector<Tile> tile_list;
+    if (rect.isEmpty()) {
+        return tile_list;
+    }
+
+    qreal size = TILE_SIZE / getScale(zoom);
+    int left = qMax(0, qFloor(rect.left() / size));
+    int top = qMax(0, qFloor(rect.top() / size));
+    int right = qCeil(rect.right() / size);
+    int bottom = qCeil(rect.bottom() / size);
+    for (int y = top; y < bottom; ++y) {
+        for (int x = left; x < right; ++x) {
+            tile_list.push_back({zoom, x, y});
+        }
+    }
+    return tile_list;
+}
+
+qint64 MapTileCache::getMemoryBudget() const {
+    return m_tiles.maxCost();
+}
+
+void MapTileCache::setMemoryBudget(qint64 bytes) {
+    m_tiles.setMaxCost(bytes);
+}
+
+int MapTileCache::addLayer() {
+    return ++m_lastLayer;
+}
+
+// Rendering tasks of the layer refer to its geometry, so they are
+// cancelled or waited for before the layer goes away
+void MapTileCache::removeLayer(int layer) {
+    const auto watcher_list = m_running.values(layer);
+    for (auto watcher : watcher_list) {
+        watcher->cancel();
+    }
+    for (auto watcher : watcher_list) {
+        watcher->waitForFinished();
+    }
+    m_running.remove(layer);
+
+    const auto keys = m_tiles.keys();
+    for (const Key& key : keys) {
+        if (key.first == layer) {
+            m_tiles.remove(key);
+        }
+    }
+
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (it.key().first == layer) {
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Also marks the tile as the most recently used one
+const QImage* MapTileCache::find(int layer, const Tile& tile) {
+    return m_tiles.object(Key(layer, getKey(tile)));
+}
+
+// Renders the tile in background unless it is cached or already pending
+void MapTileCache::request(
+        int layer, const Tile& tile, std::function<QImage()> render) {
+    Key key(layer, getKey(tile));
+    if (m_tiles.contains(key) || m_pending.contains(key)) {
+        return;
+    }
+
+    quint64 serial = ++m_serial;
+    m_pending.insert(key, serial);
+
+    auto watcher = new QFutureWatcher<QImage>(this);
+    m_running.insert(layer, watcher);
+    QObject::connect(
+        watcher, &QFutureWatcher<QImage>::finished,
+        this, [this, watcher, key, serial]() {
+            watcher->deleteLater();
+            m_running.remove(key.first, watcher);
+            if (m_pending.value(key) != serial) {
+                return; // Invalidated or removed while rendering
+            }
+            m_pending.remove(key);
+
+            QImage image = watcher->result();
+            qint64 cost = image.sizeInBytes();
+            m_tiles.insert(key, new QImage(std::move(image)), cost);
+            emit tileRendered(key.first, getTileRect(getTile(key.second)));
+        });
+
+    watcher->setFuture(QtConcurrent::run(&m_pool, std::move(render)));
+}
+
+// Drops the tiles of the layer overlapping the rect, including pending ones
+void MapTileCache::invalidate(int layer, const QRectF& rect) {
+    const auto keys = m_tiles.keys();
+    for (const Key& key : keys) {
+        if (key.first == layer &&
+                getTileRect(getTile(key.second)).intersects(rect)) {
+            m_tiles.remove(key);
+        }
+    }
+
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (it.key().first == layer &&
+                getTileRect(getTile(it.key().second)).intersects(rect)) {
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Private Methods
+
+quint64 MapTileCache::getKey(const Tile& tile) {
+    Q_ASSERT(tile.x >= 0 && tile.y >= 0);
+    return (quint64(quint8(tile.zoom)) << 56) |
+        (quint64(tile.x & 0x0FFFFFFF) << 28) |
+        quint64(tile.y & 0x0FFFFFFF);
+}
+
+MapTileCache::Tile MapTileCache::getTile(quint64 key) {
+    return {
+        qint8(key >> 56),
+        int((key >> 28) & 0x0FFFFFFF),
+        int(key & 0x0FFFFFFF)
+    };
+}
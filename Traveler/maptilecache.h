@@ -0,0 +1,74 @@
+#ifndef MAPTILECACHE_H
+#define MAPTILECACHE_H
+
+#include <QCache>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPair>
+#include <QRectF>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+// Raster tiles of map layers at power-of-two zoom levels. One cache is
+// shared by all layers of a view, so the layers render on one pool of
+// workers and together stay within one memory budget, the least recently
+// used tiles are dropped first.
+class MapTileCache : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int TILE_SIZE = 256; // In pixels
+    static constexpr qint64 DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+    // Setting of the budget in megabytes
+    static constexpr const char* MEMORY_BUDGET_KEY = "tiles/memoryBudget";
+
+    struct Tile {
+        int zoom; // Scale of the tile is 2^zoom
+        int x;
+        int y;
+    };
+
+    explicit MapTileCache(QObject *parent = nullptr);
+    ~MapTileCache();
+
+    static int getZoom(qreal scale);
+    static qreal getScale(int zoom);
+    static QRectF getTileRect(const Tile& tile);
+    static QVector<Tile> getTiles(int zoom, const QRectF& rect);
+
+    qint64 getMemoryBudget() const;
+    void setMemoryBudget(qint64 bytes);
+
+    int addLayer();
+    void removeLayer(int layer);
+
+    const QImage* find(int layer, const Tile& tile);
+    void request(int layer, const Tile& tile, std::function<QImage()> render);
+    void invalidate(int layer, const QRectF& rect);
+
+signals:
+    void tileRendered(int layer, const QRectF& rect);
+
+private:
+    typedef QPair<int, quint64> Key; // Layer and tile
+
+    static quint64 getKey(const Tile& tile);
+    static Tile getTile(quint64 key);
+
+private:
+    static constexpr int MIN_ZOOM = -8;
+    static constexpr int MAX_ZOOM = 8;
+
+    QThreadPool m_pool;
+    QCache<Key, QImage> m_tiles; // Cost is the size in bytes
+    QHash<Key, quint64> m_pending; // Request serial by tile
+    QMultiHash<int, QFutureWatcher<QImage>*> m_running; // By layer
+    quint64 m_serial;
+    int m_lastLayer;
+};
+
+#endif // MAPTILECACHE_H
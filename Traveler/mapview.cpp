@@ -1,96 +1,151 @@
 #include "mapview.h"
 
-#include <QCoreApplication>
 #include <QFile>
 #include <QFileInfo>
-#include <QDir>
 #include <QMessageBox>
 #include <QMouseEvent>
+#include <QSettings>
 #include <QToolTip>
+#include <QtConcurrent>
 
-const char* RUSSIA_BASE_FILE_NAME = "data/russia-base.svg";
-const char* RUSSIA_FILE_NAME = "data/russia.svg";
-const char* WORLD_BASE_FILE_NAME = "data/world-base.svg";
-const char* WORLD_FILE_NAME = "data/world.svg";
+#include "trace.h"
+
+static QPen itemPen() {
+    return QPen(QBrush(QColorConstants::Black), 0.25f);
+}
+
+static QBrush pointBrush(const MapPoint& point) {
+    if (point.isChecked()) {
+        return QBrush(QColorConstants::Svg::orange);
+    }
+    return QBrush(QColorConstants::Svg::firebrick);
+}
+
+static QGraphicsEllipseItem* addPointItem(
+        QGraphicsScene* scene, QPointF point,
+        float radius, const QBrush& brush) {
+    return scene->addEllipse(
+        point.x() - radius,
+        point.y() - radius,
+        2.0f * radius, 2.0f * radius,
+        itemPen(), brush);
+}
 
 // Public Methods
 
 MapView::MapView(QWidget *parent)
-        : QGraphicsView{parent}, m_map(nullptr),
-          m_newPoint(nullptr), m_changed(false) {
-    auto scene = new QGraphicsScene(this);
-    setScene(scene);
+        : QGraphicsView{parent}, m_catalog(nullptr),
+          m_emptyScene(new QGraphicsScene(this)),
+          m_current(nullptr), m_map(nullptr),
+          m_newPoint(nullptr), m_newPointItem(nullptr) {
+    setScene(m_emptyScene);
     setTransformationAnchor(AnchorUnderMouse);
     setDragMode(ScrollHandDrag);
-    setViewportUpdateMode(FullViewportUpdate);
-    selectLocation(Location::Russia);
+    setViewportUpdateMode(MinimalViewportUpdate);
     viewport()->setCursor(Qt::ArrowCursor);
+
+    m_settleTimer.setSingleShot(true);
+    m_settleTimer.setInterval(SETTLE_TIMEOUT);
+    QObject::connect(
+        &m_settleTimer, &QTimer::timeout,
+        this, &MapView::finishInteraction);
+
+    m_hoverTimer.setSingleShot(true);
+    m_hoverTimer.setInterval(HOVER_INTERVAL);
+    QObject::connect(
+        &m_hoverTimer, &QTimer::timeout,
+        this, &MapView::updateHover);
+
+    QSettings settings;
+    qint64 budget = settings.value(
+        MapTileCache::MEMORY_BUDGET_KEY,
+        MapTileCache::DEFAULT_MEMORY_BUDGET / (1024 * 1024)).toLongLong();
+    if (budget > 0) {
+        m_tiles.setMemoryBudget(budget * 1024 * 1024);
+    }
 }
 
 MapView::~MapView() {
-    releaseMap();
+    for (auto watcher : qAsConst(m_loadingMaps)) {
+        watcher->waitForFinished();
+        delete watcher->result();
+    }
+    for (auto watcher : qAsConst(m_countingMaps)) {
+        watcher->waitForFinished();
+    }
+
+    unsetNewPoint();
+    store();
+    for (auto entry : qAsConst(m_maps)) {
+        releaseMap(entry);
+    }
+
+    // Released while loading by now
+    for (auto it = m_loadingChildren.cbegin(); it != m_loadingChildren.cend(); ++it) {
+        it.value()->waitForFinished();
+        delete it.value()->result();
+        delete it.key();
+    }
+}
+
+// Resolves the detail maps of regions
+void MapView::setCatalog(const MapCatalog* catalog) {
+    m_catalog = catalog;
 }
 
 qreal MapView::zoomFactor() const {
     return transform().m11();
 }
 
-void MapView::updateScene() {
-    QGraphicsScene *s = scene();
-    s->clear();
-    s->setSceneRect(QRectF(QPointF(0, 0), m_map->getSize()));
-    QPen pen(QBrush(QColorConstants::Black), 0.25f);
-
-    const QVector<MapRegion>& region_list = m_map->getRegionList();
-    for (const MapRegion& region : region_list) {
-        QBrush brush(QColorConstants::Svg::lightgray);
-        if (region.isVisited()) {
-            brush.setColor(QColorConstants::Svg::lightgreen);
-        }
-        if (region.isChecked()) {
-            brush.setColor(QColorConstants::Svg::lightyellow);
-        }
+void MapView::updateRegion(const MapRegion* region) {
+    Q_ASSERT(region != nullptr);
+    TRACE_SCOPE("MapView::updateRegion");
 
-        for (const QPolygonF& p : region.getPolygonList()) {
-            s->addPolygon(p, pen, brush);
-        }
-    }
+    m_current->layer->updateRegion(region);
+}
 
-    float radius = m_map->getPointRadius();
-    const QVector<MapPoint>& point_list = m_map->getPointList();
-    for (const MapPoint& point : point_list) {
-        QBrush brush(QColorConstants::Svg::firebrick);
-        if (point.isChecked()) {
-            brush.setColor(QColorConstants::Svg::orange);
-        }
-        s->addEllipse(
-            point.getPoint().x() - radius,
-            point.getPoint().y() - radius,
-            2.0f * radius, 2.0f * radius,
-            pen, brush);
+// Returns nullptr for a stale handle
+MapPoint* MapView::getPoint(PointHandle handle) {
+    if (m_map == nullptr) {
+        return nullptr;
     }
+    return m_map->getPoint(handle);
+}
 
-    if (m_newPoint) {
-        QBrush brush(QColorConstants::Svg::orange);
-        s->addEllipse(
-            m_newPoint->x() - radius,
-            m_newPoint->y() - radius,
-            2.0f * radius, 2.0f * radius,
-            pen, brush);
-    }
+void MapView::updatePoint(PointHandle handle) {
+    int id = m_map->getPointIndex(handle);
+    Q_ASSERT(id >= 0 && id < m_current->pointItems.size());
+    m_current->pointItems[id]->setBrush(pointBrush(m_map->getPointList()[id]));
+}
 
+void MapView::setVisited(MapRegion* region, bool visited) {
+    m_map->setVisited(region, visited);
+    updateRegion(region);
     updateStats();
 }
 
+void MapView::setRegionName(MapRegion* region, const QString& name) {
+    m_map->setRegionName(region, name);
+}
+
+void MapView::setPointName(PointHandle handle, const QString& name) {
+    m_map->setPointName(handle, name);
+}
+
+void MapView::setPointPhotos(PointHandle handle, const QStringList& photos) {
+    m_map->setPointPhotos(handle, photos);
+}
+
 void MapView::markChanged() {
-    m_changed = true;
+    if (m_current != nullptr) {
+        m_current->changed = true;
+    }
 }
 
+// Stores all loaded maps that have been changed
 void MapView::store() {
-    if (m_map != nullptr && m_changed) {
-        Q_ASSERT(m_filePath != nullptr);
-        m_map->store(m_filePath);
-        m_changed = false;
+    for (auto it = m_maps.cbegin(); it != m_maps.cend(); ++it) {
+        storeMap(it.key(), it.value());
     }
 }
 
@@ -99,59 +154,133 @@ void MapView::unsetNewPoint() {
         delete m_newPoint;
     }
     m_newPoint = nullptr;
+
+    if (m_newPointItem != nullptr) {
+        delete m_newPointItem;
+    }
+    m_newPointItem = nullptr;
 }
 
-MapPoint* MapView::addNewPoint(const QString& name) {
+PointHandle MapView::addNewPoint(const QString& name) {
     Q_ASSERT(m_newPoint != nullptr);
-    return m_map->addPoint(*m_newPoint, name);
+    PointHandle handle = m_map->addPoint(*m_newPoint, name);
+    const MapPoint* point = m_map->getPoint(handle);
+    m_current->pointItems.push_back(addPointItem(
+        m_current->scene, point->getPoint(),
+        m_map->getPointRadius(), pointBrush(*point)));
+    updateStats();
+    return handle;
 }
 
-void MapView::removePoint(MapPoint* point) {
-    Q_ASSERT(point != nullptr);
-    m_map->removePoint(point);
+// Mirrors MapObject::removePoint, which moves the last point in place
+// of the removed one
+void MapView::removePoint(PointHandle handle) {
+    int id = m_map->getPointIndex(handle);
+    auto& items = m_current->pointItems;
+    Q_ASSERT(id >= 0 && id < items.size());
+    m_map->removePoint(handle);
+
+    delete items[id];
+    items[id] = items.back();
+    items.pop_back();
+    updateStats();
 }
 
-void MapView::selectLocation(Location location) {
-    const char* filename =
-        location == Location::Russia ?
-                    RUSSIA_FILE_NAME : WORLD_FILE_NAME;
-    const char* baseFilename =
-        location == Location::Russia ?
-                    RUSSIA_BASE_FILE_NAME : WORLD_BASE_FILE_NAME;
+// Adds the points to the current map in one batch, geographic ones are
+// placed through the bounds of the map file. Returns the number of added
+// points, or -1 on error.
+int MapView::importPoints(
+        QVector<PointImporter::Point> point_list,
+        bool geographic, QString& error) {
+    if (m_map == nullptr) {
+        error = "No map is loaded";
+        return -1;
+    }
+
+    if (geographic) {
+        QRectF bounds;
+        if (!MapFile::readBounds(m_map->getFilename(), bounds)) {
+            error = "The map has no geographic bounds, "
+                "only x and y coordinates can be imported";
+            return -1;
+        }
+        PointImporter::georeference(point_list, bounds, m_map->getSize());
+    }
+
+    QVector<QPair<QPointF, QString>> batch;
+    batch.reserve(point_list.size());
+    for (const PointImporter::Point& point : qAsConst(point_list)) {
+        batch.push_back({point.point, point.name});
+    }
+
+    int first = m_map->getPointList().size();
+    int count = m_map->addPoints(batch);
+
+    float radius = m_map->getPointRadius();
+    const QVector<MapPoint>& map_point_list = m_map->getPointList();
+    m_current->pointItems.reserve(map_point_list.size());
+    for (int i = first; i < map_point_list.size(); ++i) {
+        m_current->pointItems.push_back(addPointItem(
+            m_current->scene, map_point_list[i].getPoint(),
+            radius, pointBrush(map_point_list[i])));
+    }
 
-    auto execPath = QCoreApplication::applicationDirPath();
-    auto filePath = QDir::cleanPath(execPath + QDir::separator() + filename);
+    if (count > 0) {
+        markChanged();
+        updateStats();
+    }
+    return count;
+}
+
+// Switches to a cached map right away, otherwise loads it in background
+// The map is saved to the file path, until then it is loaded from the
+// base file
+void MapView::selectMap(const QString& filePath, const QString& baseFilePath) {
     if (m_filePath == filePath) {
         return;
-    } else {
-        store();
-        releaseMap();
-        m_filePath = filePath;
+    }
+
+    unsetNewPoint();
+    m_filePath = filePath;
+
+    MapEntry* entry = m_maps.value(m_filePath);
+    showMap(entry);
+    if (entry != nullptr || m_loadingMaps.contains(m_filePath)) {
+        return;
     }
 
     if (QFileInfo::exists(m_filePath)) {
-        m_map = new MapObject(m_filePath);
-        updateScene();
+        loadMap(m_filePath, m_filePath);
+    } else if (QFileInfo::exists(baseFilePath)) {
+        loadMap(m_filePath, baseFilePath);
     } else {
-        filePath = QDir::cleanPath(execPath + QDir::separator() + baseFilename);
-        if (QFileInfo::exists(filePath)) {
-            m_map = new MapObject(filePath);
-            updateScene();
-        } else {
-            QMessageBox msgBox;
-            msgBox.setText("Unable to find base map file: " + filePath);
-            msgBox.setWindowTitle("Warning");
-            msgBox.exec();
-        }
+        m_filePath = QString();
+        emit loadFailed();
+
+        QMessageBox msgBox;
+        msgBox.setText("Unable to find base map file: " + baseFilePath);
+        msgBox.setWindowTitle("Warning");
+        msgBox.exec();
     }
 }
 
+MapStats MapView::getStats() const {
+    return m_stats;
+}
+
+// Emits statsChanged only if the numbers differ from the last ones
 void MapView::updateStats() {
-    uint regionsTotal = 0;
-    uint regionsVisited = 0;
-    uint poinsVisited = 0;
-    m_map->getStats(regionsTotal, regionsVisited, poinsVisited);
-    emit statsChanged(regionsTotal, regionsVisited, poinsVisited);
+    if (m_map == nullptr) {
+        return;
+    }
+
+    MapStats stats = m_map->getStats();
+    if (stats == m_stats) {
+        return;
+    }
+    m_stats = stats;
+    emit statsChanged(
+        m_stats.regionsTotal, m_stats.regionsVisited, m_stats.pointsVisited);
 }
 
 // Private Methods
@@ -161,27 +290,416 @@ void MapView::zoomBy(qreal factor) {
     if ((factor < 1 && currentZoom < 0.1) || (factor > 1 && currentZoom > 10)) {
         return;
     }
+    startInteraction();
     scale(factor, factor);
+    updateLevel();
+}
+
+// Switches the map layer to the level of detail of the current zoom
+void MapView::updateLevel() {
+    if (m_current == nullptr) {
+        return;
+    }
+
+    TRACE_SCOPE("MapView::updateLevel");
+    m_current->layer->setLevel(MapRegion::getLevel(zoomFactor()));
+    for (ChildMap* child : qAsConst(m_current->children)) {
+        if (child->layer != nullptr) {
+            child->layer->setLevel(
+                MapRegion::getLevel(zoomFactor() * child->scale));
+        }
+    }
+}
+
+// Until the view settles, the map layers are painted from raster tiles
+void MapView::startInteraction() {
+    if (m_current != nullptr) {
+        m_current->layer->setInteractive(true);
+        for (ChildMap* child : qAsConst(m_current->children)) {
+            if (child->layer != nullptr) {
+                child->layer->setInteractive(true);
+            }
+        }
+        m_settleTimer.start();
+    }
+}
+
+// Detail maps follow the settled view
+void MapView::finishInteraction() {
+    m_settleTimer.stop();
+    if (m_current != nullptr) {
+        m_current->layer->setInteractive(false);
+        for (ChildMap* child : qAsConst(m_current->children)) {
+            if (child->layer != nullptr) {
+                child->layer->setInteractive(false);
+            }
+        }
+        updateChildren();
+    }
+}
+
+// Hit-tests the last mouse position and shows the name of the object
+// under it. The tooltip is only touched when the object changes, or to
+// bring it back once it has expired.
+void MapView::updateHover() {
+    if (m_map == nullptr) {
+        return;
+    }
+
+    TRACE_SCOPE("MapView::updateHover");
+    bool changed = m_hover.update(m_map, mapToScene(m_hoverPos));
+    if (!changed && QToolTip::isVisible()) {
+        return;
+    }
+
+    QString text = m_hover.getText(m_map);
+    if (text.isEmpty()) {
+        QToolTip::hideText();
+    } else {
+        QToolTip::showText(
+            viewport()->mapToGlobal(m_hoverPos), text, viewport());
+    }
 }
 
 void MapView::setNewPoint(QPointF point) {
     m_newPoint = new QPointF(point);
+    m_newPointItem = addPointItem(
+        m_current->scene, point, m_map->getPointRadius(),
+        QBrush(QColorConstants::Svg::orange));
 }
 
-void MapView::releaseMap() {
-    if (m_map != nullptr) {
-        delete m_map;
+void MapView::loadMap(const QString& filePath, const QString& sourceFilePath) {
+    auto watcher = new QFutureWatcher<MapObject*>(this);
+    m_loadingMaps.insert(filePath, watcher);
+
+    QObject::connect(
+        watcher, &QFutureWatcher<MapObject*>::finished,
+        this, [this, watcher, filePath]() {
+            m_loadingMaps.remove(filePath);
+            watcher->deleteLater();
+            mapLoaded(filePath, watcher->result());
+        });
+
+    watcher->setFuture(QtConcurrent::run([sourceFilePath]() {
+        return new MapObject(sourceFilePath);
+    }));
+
+    emit loadingStarted();
+}
+
+void MapView::mapLoaded(const QString& filePath, MapObject* map) {
+    if (!map->isValid()) {
+        delete map;
+        if (filePath == m_filePath) {
+            m_filePath = QString();
+            emit loadFailed();
+        }
+        if (m_loadingMaps.isEmpty()) {
+            emit loadingFinished();
+        }
+
+        QMessageBox msgBox;
+        msgBox.setText("Unable to load map file: " + filePath);
+        msgBox.setWindowTitle("Warning");
+        msgBox.exec();
+        return;
+    }
+
+    auto entry = new MapEntry{
+        map, new QGraphicsScene(this), nullptr, {}, false, {}, {}};
+    buildScene(entry);
+    m_maps.insert(filePath, entry);
+
+    if (filePath == m_filePath) {
+        showMap(entry);
+    } else {
+        m_recentMaps.append(filePath);
+        evictMaps();
+    }
+
+    if (m_loadingMaps.isEmpty()) {
+        emit loadingFinished();
+    }
+}
+
+void MapView::showMap(MapEntry* entry) {
+    m_settleTimer.stop();
+    if (m_current != nullptr) {
+        // Only the detail maps of the shown map are kept
+        releaseChildren(m_current);
+        m_current->layer->setInteractive(false);
+    }
+
+    m_hover.reset();
+    m_current = entry;
+    if (m_current == nullptr) {
         m_map = nullptr;
+        setScene(m_emptyScene);
+        return;
     }
-    if (m_newPoint != nullptr) {
-        delete m_newPoint;
-        m_newPoint = nullptr;
+
+    m_map = m_current->map;
+    setScene(m_current->scene);
+    updateLevel();
+    updateChildren();
+    updateLinks(m_current);
+
+    m_recentMaps.removeAll(m_filePath);
+    m_recentMaps.prepend(m_filePath);
+    evictMaps();
+
+    updateStats();
+}
+
+// A map that couldn't be saved stays changed, so saving is tried again
+bool MapView::storeMap(const QString& filePath, MapEntry* entry) {
+    if (!entry->changed) {
+        return true;
+    }
+
+    if (!entry->map->store(filePath)) {
+        QMessageBox msgBox;
+        msgBox.setText("Unable to save map file: " + filePath);
+        msgBox.setWindowTitle("Warning");
+        msgBox.exec();
+        return false;
+    }
+    entry->changed = false;
+    return true;
+}
+
+void MapView::releaseMap(MapEntry* entry) {
+    releaseChildren(entry);
+    delete entry->scene;
+    delete entry->map;
+    delete entry;
+}
+
+// Drops the least recently shown maps, saving them first. A map that
+// can't be saved is kept along with its changes.
+void MapView::evictMaps() {
+    while (m_recentMaps.size() > MAX_CACHED_MAPS) {
+        QString filePath = m_recentMaps.last();
+        MapEntry* entry = m_maps.value(filePath);
+        Q_ASSERT(entry != nullptr && entry != m_current);
+        if (!storeMap(filePath, entry)) {
+            break;
+        }
+        m_recentMaps.removeLast();
+        m_maps.remove(filePath);
+        m_visitedMaps.insert(
+            filePath, entry->map->getStats().regionsVisited > 0);
+        releaseMap(entry);
+    }
+}
+
+void MapView::buildScene(MapEntry* entry) {
+    TRACE_SCOPE("MapView::buildScene");
+    QGraphicsScene *s = entry->scene;
+    MapObject* map = entry->map;
+    s->setSceneRect(QRectF(QPointF(0, 0), map->getSize()));
+
+    entry->layer = new MapLayerItem(map, &m_tiles);
+    entry->layer->setZValue(-1); // Detail maps go above
+    s->addItem(entry->layer);
+    entry->links = map->getLinkedRegions();
+
+    float radius = map->getPointRadius();
+    const QVector<MapPoint>& point_list = map->getPointList();
+    entry->pointItems.reserve(point_list.size());
+    for (const MapPoint& point : point_list) {
+        entry->pointItems.push_back(
+            addPointItem(s, point.getPoint(), radius, pointBrush(point)));
+    }
+}
+
+// Loads the detail maps of the regions in view that cover a good part
+// of the viewport, and releases the ones out of view or zoomed out of
+void MapView::updateChildren() {
+    if (m_current == nullptr || m_current->links.isEmpty()) {
+        return;
+    }
+
+    TRACE_SCOPE("MapView::updateChildren");
+    QRectF visible = mapToScene(viewport()->rect()).boundingRect();
+    qreal zoom = zoomFactor();
+    for (MapRegion* region : qAsConst(m_current->links)) {
+        QRectF rect = m_current->layer->getRegionRect(region);
+        bool inView = rect.intersects(visible);
+        qreal coverage = qMax(
+            rect.width() * zoom / viewport()->width(),
+            rect.height() * zoom / viewport()->height());
+
+        // Released at a smaller coverage than loaded, so that zooming
+        // around the threshold doesn't reload the map
+        ChildMap* child = m_current->children.value(region);
+        if (child == nullptr && inView && coverage >= CHILD_MAP_COVERAGE) {
+            loadChild(m_current, region);
+        } else if (child != nullptr &&
+                   (!inView || coverage < CHILD_MAP_COVERAGE / 2)) {
+            releaseChild(child);
+        }
+    }
+}
+
+void MapView::loadChild(MapEntry* entry, MapRegion* region) {
+    Q_ASSERT(!entry->children.contains(region));
+    int index = m_catalog == nullptr ?
+        -1 : m_catalog->indexOf(region->getChildMap());
+    if (index < 0) {
+        return;
+    }
+
+    auto child = new ChildMap{entry, region, nullptr, nullptr, nullptr, 1.0};
+    entry->children.insert(region, child);
+
+    auto watcher = new QFutureWatcher<MapObject*>(this);
+    m_loadingChildren.insert(child, watcher);
+
+    QObject::connect(
+        watcher, &QFutureWatcher<MapObject*>::finished,
+        this, [this, watcher, child]() {
+            m_loadingChildren.remove(child);
+            watcher->deleteLater();
+            childLoaded(child, watcher->result());
+        });
+
+    QString filePath = m_catalog->getSourceFilePath(index);
+    watcher->setFuture(QtConcurrent::run([filePath]() {
+        return new MapObject(filePath);
+    }));
+}
+
+// The detail map is placed by the transform of the link, between the
+// map layer and the points
+void MapView::childLoaded(ChildMap* child, MapObject* map) {
+    if (child->entry == nullptr) {
+        delete map;
+        delete child;
+        return;
+    }
+
+    TRACE_SCOPE("MapView::childLoaded");
+    MapEntry* entry = child->entry;
+    Q_ASSERT(entry == m_current);
+    if (!map->isValid()) {
+        entry->children.remove(child->region);
+        delete map;
+        delete child;
+        return;
+    }
+
+    child->map = map;
+
+    // Clipped to the outline of the region, the region itself shows
+    // through where the maps don't quite match
+    QPainterPath outline;
+    outline.setFillRule(Qt::WindingFill);
+    for (const QPolygonF& polygon : child->region->getPolygonList()) {
+        outline.addPolygon(polygon);
+        outline.closeSubpath();
+    }
+    child->clip = new QGraphicsPathItem(outline);
+    child->clip->setPen(Qt::NoPen);
+    child->clip->setFlag(QGraphicsItem::ItemClipsChildrenToShape);
+    child->clip->setZValue(-0.5);
+
+    const QTransform& transform = child->region->getChildTransform();
+    child->scale = qSqrt(qAbs(transform.determinant()));
+    child->layer = new MapLayerItem(map, &m_tiles);
+    child->layer->setTransform(transform);
+    child->layer->setLevel(MapRegion::getLevel(zoomFactor() * child->scale));
+    child->layer->setInteractive(entry->layer->isInteractive());
+    child->layer->setParentItem(child->clip);
+    entry->scene->addItem(child->clip);
+}
+
+// A region is shown visited once any region of its detail map is. The
+// detail map is read from the loaded maps, or counted in background.
+void MapView::updateLinks(MapEntry* entry) {
+    if (m_catalog == nullptr) {
+        return;
+    }
+
+    for (MapRegion* region : qAsConst(entry->links)) {
+        int index = m_catalog->indexOf(region->getChildMap());
+        if (index < 0) {
+            continue;
+        }
+
+        const QString& filePath = m_catalog->getEntry(index).filePath;
+        MapEntry* child = m_maps.value(filePath);
+        bool visited = false;
+        if (child != nullptr) {
+            visited = child->map->getStats().regionsVisited > 0;
+        } else if (m_visitedMaps.contains(filePath)) {
+            visited = m_visitedMaps.value(filePath);
+        } else {
+            countVisited(index);
+            continue;
+        }
+
+        if (visited != region->isChildVisited()) {
+            entry->map->setChildVisited(region, visited);
+            entry->layer->updateRegion(region);
+        }
+    }
+}
+
+void MapView::countVisited(int index) {
+    QString filePath = m_catalog->getEntry(index).filePath;
+    if (m_countingMaps.contains(filePath)) {
+        return;
+    }
+
+    auto watcher = new QFutureWatcher<bool>(this);
+    m_countingMaps.insert(filePath, watcher);
+
+    QObject::connect(
+        watcher, &QFutureWatcher<bool>::finished,
+        this, [this, watcher, filePath]() {
+            m_countingMaps.remove(filePath);
+            watcher->deleteLater();
+            m_visitedMaps.insert(filePath, watcher->result());
+            if (m_current != nullptr) {
+                updateLinks(m_current);
+                updateStats();
+            }
+        });
+
+    QString sourceFilePath = m_catalog->getSourceFilePath(index);
+    watcher->setFuture(QtConcurrent::run([sourceFilePath]() {
+        MapObject map(sourceFilePath);
+        return map.getStats().regionsVisited > 0;
+    }));
+}
+
+// A detail map that is still loading is dropped once it is loaded
+void MapView::releaseChild(ChildMap* child) {
+    MapEntry* entry = child->entry;
+    Q_ASSERT(entry != nullptr);
+    entry->children.remove(child->region);
+    if (child->map == nullptr) {
+        child->entry = nullptr;
+        return;
+    }
+
+    delete child->clip; // Along with the layer
+    delete child->map;
+    delete child;
+}
+
+void MapView::releaseChildren(MapEntry* entry) {
+    const auto child_list = entry->children.values();
+    for (ChildMap* child : child_list) {
+        releaseChild(child);
     }
 }
 
 // Protected Signals
 
 void MapView::paintEvent(QPaintEvent *event) {
+    TRACE_SCOPE("MapView::paintEvent");
     QGraphicsView::paintEvent(event);
 }
 
@@ -190,43 +708,55 @@ void MapView::wheelEvent(QWheelEvent *event) {
 }
 
 void MapView::mousePressEvent(QMouseEvent *event) {
-    if (event->button() == Qt::RightButton) {
+    if (event->button() == Qt::RightButton && m_map != nullptr) {
         QPointF point = mapToScene(event->pos());
 
         unsetNewPoint();
         emit pointUnchecked();
         emit regionUnchecked();
 
-        MapPoint* p = m_map->getPoint(point);
-        if (p != nullptr) {
-            emit pointChecked(p);
+        PointHandle handle = m_map->findPoint(point);
+        if (!handle.isNull()) {
+            emit pointChecked(handle);
         } else {
             MapRegion* region = m_map->getRegion(point);
             if (region != nullptr) {
                 emit regionChecked(region);
             }
         }
-
-        updateScene();
     } else {
         QGraphicsView::mousePressEvent(event);
     }
 }
 
 void MapView::mouseDoubleClickEvent(QMouseEvent *event) {
-    if (event->button() == Qt::LeftButton) {
+    if (event->button() == Qt::LeftButton && m_map != nullptr) {
         QPointF point = mapToScene(event->pos());
         unsetNewPoint();
         emit pointUnchecked();
         emit regionUnchecked();
 
         MapRegion* region = m_map->getRegion(point);
-        if (region != nullptr) {
-            setNewPoint(point);
-            emit pointAdded();
+        if (region == nullptr) {
+            return;
+        }
+
+        // Ctrl + double click zooms into a region with a detail map and
+        // loads the map right away, a plain one adds a point as anywhere
+        if ((event->modifiers() & Qt::ControlModifier) &&
+                !region->getChildMap().isEmpty()) {
+            startInteraction();
+            fitInView(
+                m_current->layer->getRegionRect(region), Qt::KeepAspectRatio);
+            updateLevel();
+            if (!m_current->children.contains(region)) {
+                loadChild(m_current, region);
+            }
+            return;
         }
 
-        updateScene();
+        setNewPoint(point);
+        emit pointAdded();
     }
 }
 
@@ -235,22 +765,27 @@ void MapView::mouseReleaseEvent(QMouseEvent *event) {
     viewport()->setCursor(Qt::ArrowCursor);
 }
 
+void MapView::scrollContentsBy(int dx, int dy) {
+    startInteraction();
+    QGraphicsView::scrollContentsBy(dx, dy);
+}
+
 void MapView::mouseMoveEvent(QMouseEvent *event) {
     QGraphicsView::mouseMoveEvent(event);
 
-    QString text;
-    QPointF p = mapToScene(event->pos());
-    auto point = m_map->getPoint(p);
-    if (point != nullptr) {
-        text = point->getName();
-    } else {
-        auto region = m_map->getRegion(p);
-        if (region != nullptr) {
-            text = region->getName();
-        }
+    // No hover while the map is dragged
+    if (m_map == nullptr || event->buttons() != Qt::NoButton) {
+        return;
     }
 
-    if (!text.isEmpty()) {
-        QToolTip::showText(event->globalPosition().toPoint(), text);
+    m_hoverPos = event->pos();
+    if (!m_hoverTimer.isActive()) {
+        m_hoverTimer.start();
     }
 }
+
+void MapView::leaveEvent(QEvent *event) {
+    QGraphicsView::leaveEvent(event);
+    m_hoverTimer.stop();
+    m_hover.reset();
+}
@@ -1,16 +1,20 @@
 #ifndef MAPVIEW_H
 #define MAPVIEW_H
 
-#include <QDomDocument>
+#include <QFutureWatcher>
+#include <QGraphicsItem>
 #include <QGraphicsView>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
 #include <QVector>
 
-#include "mapobject.h"
-
-enum Location {
-    Russia,
-    World
-};
+#include "hovertracker.h"
+#include "mapcatalog.h"
+#include "maplayeritem.h"
+#include "MapObject.h"
+#include "maptilecache.h"
+#include "pointimporter.h"
 
 class MapView : public QGraphicsView {
     Q_OBJECT
@@ -19,17 +23,28 @@ public:
             QWidget *parent = nullptr);
     ~MapView();
 
+    void setCatalog(const MapCatalog* catalog);
     qreal zoomFactor() const;
-    void updateScene();
+    void updateRegion(const MapRegion* region);
+    MapPoint* getPoint(PointHandle handle);
+    void updatePoint(PointHandle handle);
+    void setVisited(MapRegion* region, bool visited);
+    void setRegionName(MapRegion* region, const QString& name);
+    void setPointName(PointHandle handle, const QString& name);
+    void setPointPhotos(PointHandle handle, const QStringList& photos);
 
     void markChanged();
     void store();
 
-    MapPoint* addNewPoint(const QString& name);
+    PointHandle addNewPoint(const QString& name);
     void unsetNewPoint();
-    void removePoint(MapPoint* point);
+    void removePoint(PointHandle handle);
+    int importPoints(
+            QVector<PointImporter::Point> point_list,
+            bool geographic, QString& error);
 
-    void selectLocation(Location location);
+    void selectMap(const QString& filePath, const QString& baseFilePath);
+    MapStats getStats() const;
     void updateStats();
 
 signals:
@@ -37,7 +52,7 @@ signals:
     void regionUnchecked();
 
     void pointAdded();
-    void pointChecked(MapPoint* point);
+    void pointChecked(PointHandle handle);
     void pointUnchecked();
 
     void statsChanged(
@@ -45,6 +60,10 @@ signals:
             uint regionsVisited,
             uint pointsVisited);
 
+    void loadingStarted();
+    void loadingFinished();
+    void loadFailed(); // The selected map, which may be selected again
+
 protected:
     void wheelEvent(QWheelEvent *event) override;
     void paintEvent(QPaintEvent *event) override;
@@ -52,18 +71,86 @@ protected:
     void mouseDoubleClickEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
 
 private:
+    struct ChildMap;
+
+    // A loaded map together with its scene
+    struct MapEntry {
+        MapObject* map;
+        QGraphicsScene* scene;
+        MapLayerItem* layer; // Owned by the scene
+        QVector<QGraphicsEllipseItem*> pointItems; // Follows the point list
+        bool changed;
+        QVector<MapRegion*> links; // Regions with a detail map
+        QHash<MapRegion*, ChildMap*> children; // Loaded or loading
+    };
+
+    // Detail map drawn in place of a region of the shown map. It is only
+    // read, edits are made on the map itself.
+    struct ChildMap {
+        MapEntry* entry; // Reset if released while loading
+        MapRegion* region;
+        MapObject* map; // Null while loading
+        QGraphicsPathItem* clip; // Owned by the scene
+        MapLayerItem* layer; // Owned by the clip item
+        qreal scale; // Of the detail map in the scene
+    };
+
     void zoomBy(qreal factor);
+    void updateLevel();
+    void startInteraction();
+    void finishInteraction();
+    void updateHover();
     void setNewPoint(QPointF point);
-    void releaseMap();
+
+    void loadMap(const QString& filePath, const QString& sourceFilePath);
+    void mapLoaded(const QString& filePath, MapObject* map);
+    void showMap(MapEntry* entry);
+    bool storeMap(const QString& filePath, MapEntry* entry);
+    void releaseMap(MapEntry* entry);
+    void evictMaps();
+    void buildScene(MapEntry* entry);
+
+    void updateChildren();
+    void loadChild(MapEntry* entry, MapRegion* region);
+    void childLoaded(ChildMap* child, MapObject* map);
+    void releaseChild(ChildMap* child);
+    void releaseChildren(MapEntry* entry);
+    void updateLinks(MapEntry* entry);
+    void countVisited(int index);
 
 private:
-    MapObject* m_map;
+    static constexpr int MAX_CACHED_MAPS = 2;
+    static constexpr int SETTLE_TIMEOUT = 150; // In milliseconds
+    static constexpr int HOVER_INTERVAL = 16; // About a frame, in milliseconds
+    static constexpr qreal CHILD_MAP_COVERAGE = 0.75; // Of the viewport
+
+    QHash<QString, MapEntry*> m_maps; // By file path
+    QStringList m_recentMaps; // Most recently shown first
+    QHash<QString, QFutureWatcher<MapObject*>*> m_loadingMaps;
+    QHash<ChildMap*, QFutureWatcher<MapObject*>*> m_loadingChildren;
+    QHash<QString, bool> m_visitedMaps; // Any region visited, by file path
+    QHash<QString, QFutureWatcher<bool>*> m_countingMaps;
+    const MapCatalog* m_catalog;
+    QGraphicsScene* m_emptyScene;
+    MapTileCache m_tiles; // Shared by the layers of all scenes
+
+    MapEntry* m_current;
+    MapObject* m_map; // Map of the current entry
     QString m_filePath;
+    MapStats m_stats; // Last emitted
+    QTimer m_settleTimer; // Ends the interaction once the view settles
+
+    // Mouse moves are coalesced into one hit-test per interval
+    HoverTracker m_hover;
+    QTimer m_hoverTimer;
+    QPoint m_hoverPos; // In viewport coordinates
 
     QPointF* m_newPoint;
-    bool m_changed;
+    QGraphicsEllipseItem* m_newPointItem;
 };
 
 #endif // MAPVIEW_H
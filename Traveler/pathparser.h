@@ -0,0 +1,252 @@
+#ifndef PATHPARSER_H
+#define PATHPARSER_H
+
+#include "mapregion.h"
+#include "trace.h"
+
+#include <QPointF>
+#include <QPolygonF>
+#include <QStringView>
+#include <QVarLengthArray>
+
+#include <cmath>
+#include <utility>
+
+// Single pass parser for the "d" attribute of an SVG path.
+// Supports the move, line, horizontal, vertical and close commands in
+// both absolute and relative forms. Numbers are parsed in place from the
+// UTF-16 data, vertices are gathered in a reusable buffer and every
+// closed subpath is copied into an exactly sized polygon.
+class PathParser {
+public:
+    void parse(QStringView path, MapRegion& region) {
+        TRACE_SCOPE("PathParser::parse");
+        m_path = path;
+        m_pos = 0;
+        m_buffer.clear();
+
+        QPointF start(0.0f, 0.0f);
+        QPointF current(0.0f, 0.0f);
+        char16_t command = 0;
+
+        while (true) {
+            skipSeparators();
+            if (m_pos >= m_path.size()) {
+                break;
+            }
+
+            char16_t c = m_path[m_pos].unicode();
+            if (isCommand(c)) {
+                ++m_pos;
+                command = c;
+                if (c == u'z' || c == u'Z') {
+                    closePolygon(region);
+                    current = start;
+                    command = 0;
+                    continue;
+                }
+            }
+
+            bool ok = false;
+            switch (command) {
+            case u'M':
+            case u'm': {
+                QPointF point;
+                ok = readPoint(point);
+                if (ok) {
+                    closePolygon(region);
+                    current = command == u'm' ? current + point : point;
+                    start = current;
+                    m_buffer.push_back(current);
+                    // Following pairs are implicit line commands
+                    command = command == u'm' ? u'l' : u'L';
+                }
+                break;
+            }
+            case u'L':
+            case u'l': {
+                QPointF point;
+                ok = readPoint(point);
+                if (ok) {
+                    current = command == u'l' ? current + point : point;
+                    m_buffer.push_back(current);
+                }
+                break;
+            }
+            case u'H':
+            case u'h': {
+                float value = 0.0f;
+                ok = readNumber(value);
+                if (ok) {
+                    current.setX(command == u'h' ? current.x() + value : value);
+                    m_buffer.push_back(current);
+                }
+                break;
+            }
+            case u'V':
+            case u'v': {
+                float value = 0.0f;
+                ok = readNumber(value);
+                if (ok) {
+                    current.setY(command == u'v' ? current.y() + value : value);
+                    m_buffer.push_back(current);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+
+            // Malformed data ends the path
+            if (!ok) {
+                break;
+            }
+        }
+
+        closePolygon(region);
+        m_path = QStringView();
+    }
+
+private:
+    static bool isCommand(char16_t c) {
+        switch (c) {
+        case u'M': case u'm':
+        case u'L': case u'l':
+        case u'H': case u'h':
+        case u'V': case u'v':
+        case u'Z': case u'z':
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static bool isDigit(char16_t c) {
+        return c >= u'0' && c <= u'9';
+    }
+
+    char16_t peek(qsizetype pos) const {
+        return pos < m_path.size() ? m_path[pos].unicode() : 0;
+    }
+
+    void skipSeparators() {
+        while (m_pos < m_path.size()) {
+            char16_t c = m_path[m_pos].unicode();
+            if (c != u',' && !QChar::isSpace(c)) {
+                break;
+            }
+            ++m_pos;
+        }
+    }
+
+    bool readPoint(QPointF& point) {
+        float x = 0.0f, y = 0.0f;
+        if (!readNumber(x) || !readNumber(y)) {
+            return false;
+        }
+        point = QPointF(x, y);
+        return true;
+    }
+
+    // Parses [sign] digits [. digits] [e [sign] digits] without copying.
+    // Up to 18 significant digits are kept, which is exact for the float
+    // coordinates the map uses.
+    bool readNumber(float& value) {
+        skipSeparators();
+
+        qsizetype i = m_pos;
+        bool negative = false;
+        if (peek(i) == u'-' || peek(i) == u'+') {
+            negative = peek(i) == u'-';
+            ++i;
+        }
+
+        quint64 mantissa = 0;
+        int exponent = 0;
+        bool digits = false;
+        while (isDigit(peek(i))) {
+            if (mantissa < MAX_MANTISSA) {
+                mantissa = mantissa * 10 + (peek(i) - u'0');
+            } else {
+                ++exponent;
+            }
+            digits = true;
+            ++i;
+        }
+        if (peek(i) == u'.') {
+            ++i;
+            while (isDigit(peek(i))) {
+                if (mantissa < MAX_MANTISSA) {
+                    mantissa = mantissa * 10 + (peek(i) - u'0');
+                    --exponent;
+                }
+                digits = true;
+                ++i;
+            }
+        }
+        if (!digits) {
+            return false;
+        }
+
+        if (peek(i) == u'e' || peek(i) == u'E') {
+            qsizetype j = i + 1;
+            bool negative_exponent = false;
+            if (peek(j) == u'-' || peek(j) == u'+') {
+                negative_exponent = peek(j) == u'-';
+                ++j;
+            }
+            if (isDigit(peek(j))) {
+                int e = 0;
+                while (isDigit(peek(j))) {
+                    if (e < 1000) {
+                        e = e * 10 + (peek(j) - u'0');
+                    }
+                    ++j;
+                }
+                exponent += negative_exponent ? -e : e;
+                i = j;
+            }
+        }
+
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            result /= power10(-exponent);
+        } else if (exponent > 0) {
+            result *= power10(exponent);
+        }
+
+        value = static_cast<float>(negative ? -result : result);
+        m_pos = i;
+        return true;
+    }
+
+    static double power10(int exponent) {
+        static const double table[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        if (exponent < static_cast<int>(sizeof(table) / sizeof(table[0]))) {
+            return table[exponent];
+        }
+        return std::pow(10.0, exponent);
+    }
+
+    void closePolygon(MapRegion& region) {
+        if (m_buffer.isEmpty()) {
+            return;
+        }
+        QPolygonF polygon(m_buffer.size());
+        std::copy(m_buffer.cbegin(), m_buffer.cend(), polygon.begin());
+        region.addPolygon(std::move(polygon));
+        m_buffer.clear();
+    }
+
+private:
+    static constexpr quint64 MAX_MANTISSA = 100000000000000000ull;
+
+    QStringView m_path;
+    qsizetype m_pos = 0;
+    QVarLengthArray<QPointF, 1024> m_buffer;
+};
+
+#endif // PATHPARSER_H
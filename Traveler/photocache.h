@@ -0,0 +1,145 @@
+#ifndef PHOTOCACHE_H
+#define PHOTOCACHE_H
+
+#include "photostore.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QSize>
+
+#define PHOTO_CACHE_PATH "photo/cache"
+
+// Downscaled JPEG versions of stored photos, a thumbnail and a preview
+// of the panel size, kept under photo/cache and keyed by the photo key.
+// Views decode the smallest version that covers them instead of the
+// full-size photo.
+class PhotoCache {
+public:
+    static constexpr int THUMBNAIL_SIZE = 128;
+    static constexpr int PREVIEW_SIZE = 512;
+
+    static QString getRoot() {
+        auto execPath = QCoreApplication::applicationDirPath();
+        return QDir::cleanPath(
+            execPath + QDir::separator() + PHOTO_CACHE_PATH);
+    }
+
+    static QString getFilePath(const QString& key, int size) {
+        Q_ASSERT(key.size() > 2);
+        return getRoot() + "/" + key.left(2) + "/" + key + "." +
+            QString::number(size) + ".jpg";
+    }
+
+    // Returns the smallest version of the photo whose longer side covers
+    // the size, or the photo itself
+    static QString find(const QString& filename, QSize size) {
+        if (!isStored(filename)) {
+            return filename;
+        }
+
+        int extent = qMax(size.width(), size.height());
+        for (int version : {THUMBNAIL_SIZE, PREVIEW_SIZE}) {
+            if (version >= extent) {
+                QString path = getFilePath(QFileInfo(filename).fileName(), version);
+                if (QFileInfo::exists(path)) {
+                    return path;
+                }
+            }
+        }
+        return filename;
+    }
+
+    // Creates the missing versions of a stored photo. The preview is
+    // decoded at its size right away, the thumbnail is scaled from it.
+    static bool generate(const QString& key) {
+        QString preview = getFilePath(key, PREVIEW_SIZE);
+        QString thumbnail = getFilePath(key, THUMBNAIL_SIZE);
+        if (QFileInfo::exists(preview) && QFileInfo::exists(thumbnail)) {
+            return true;
+        }
+
+        QImageReader reader(PhotoStore::getFilePath(key));
+        QSize imageSize = reader.size();
+        if (imageSize.isValid()) {
+            reader.setScaledSize(imageSize.scaled(
+                QSize(PREVIEW_SIZE, PREVIEW_SIZE),
+                Qt::KeepAspectRatio).boundedTo(imageSize));
+        }
+        QImage image = reader.read();
+        if (image.isNull() || !QDir().mkpath(QFileInfo(preview).path())) {
+            return false;
+        }
+
+        QImage small = image.scaled(
+            THUMBNAIL_SIZE, THUMBNAIL_SIZE,
+            Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        return save(image, preview) && save(small, thumbnail);
+    }
+
+    // Generates the versions of the photos stored before the cache
+    // existed. Runs once, a marker file records that it has finished.
+    static void backfill() {
+        QString marker = getRoot() + "/.backfilled";
+        if (QFileInfo::exists(marker)) {
+            return;
+        }
+
+        QDirIterator it(
+            PhotoStore::getRoot(), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            if (!it.fileName().endsWith(".tmp")) {
+                generate(it.fileName());
+            }
+        }
+
+        if (QDir().mkpath(getRoot())) {
+            QFile file(marker);
+            file.open(QFile::WriteOnly);
+        }
+    }
+
+    // Removes the versions of photos that are no longer stored. Returns
+    // the number of removed files.
+    static int collectGarbage() {
+        int count = 0;
+        QDirIterator it(getRoot(), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+
+            // Versions are named <key>.<size>.jpg
+            QString key = it.fileName().section('.', 0, -3);
+            if (key.size() <= 2 ||
+                    QFileInfo::exists(PhotoStore::getFilePath(key))) {
+                continue;
+            }
+            if (QFile::remove(it.filePath())) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+private:
+    static constexpr int QUALITY = 85;
+
+    static bool isStored(const QString& filename) {
+        return QFileInfo(filename).absoluteFilePath().startsWith(
+            PhotoStore::getRoot() + "/");
+    }
+
+    static bool save(const QImage& image, const QString& filename) {
+        if (QFileInfo::exists(filename)) {
+            return true;
+        }
+        QSaveFile file(filename);
+        return file.open(QFile::WriteOnly) &&
+            image.save(&file, "JPG", QUALITY) && file.commit();
+    }
+};
+
+#endif // PHOTOCACHE_H
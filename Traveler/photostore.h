@@ -0,0 +1,144 @@
+#ifndef PHOTOSTORE_H
+#define PHOTOSTORE_H
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#define PHOTO_STORE_PATH "photo/store"
+
+// Photos stored by the hash of their content, under subdirectories named
+// after the first two hex digits of the hash. Points refer to photos by
+// their key, which is the hash with the suffix of the source file, so the
+// same photo is stored only once. A photo is taken into the store as a
+// reflink where the file system allows it, and copied otherwise, so that
+// editing the original leaves the stored photo intact. Stored photos are
+// immutable and made read-only.
+class PhotoStore {
+public:
+    static QString getRoot() {
+        auto execPath = QCoreApplication::applicationDirPath();
+        return QDir::cleanPath(
+            execPath + QDir::separator() + PHOTO_STORE_PATH);
+    }
+
+    static QString getFilePath(const QString& key) {
+        Q_ASSERT(key.size() > 2);
+        return getRoot() + "/" + key.left(2) + "/" + key;
+    }
+
+    // Returns the key of the photo, or an empty string on failure
+    static QString store(const QString& filename) {
+        QString hash = hashFile(filename);
+        if (hash.isEmpty()) {
+            return QString();
+        }
+
+        QString suffix = QFileInfo(filename).suffix().toLower();
+        QString key = suffix.isEmpty() ? hash : hash + "." + suffix;
+        QString target = getFilePath(key);
+        if (QFileInfo::exists(target)) {
+            return key;
+        }
+
+        if (!QDir().mkpath(QFileInfo(target).path())) {
+            return QString();
+        }
+
+        // Placed under a temporary name first, so that a stored photo
+        // is always complete
+        QString temporary = target + ".tmp";
+        QFile::remove(temporary);
+        if (!clone(filename, temporary) && !QFile::copy(filename, temporary)) {
+            return QString();
+        }
+        if (!QFile::rename(temporary, target)) {
+            QFile::remove(temporary);
+            if (!QFileInfo::exists(target)) {
+                return QString();
+            }
+            return key;
+        }
+        QFile::setPermissions(
+            target,
+            QFile::ReadOwner | QFile::ReadUser |
+            QFile::ReadGroup | QFile::ReadOther);
+        return key;
+    }
+
+    // Removes the stored photos that are not referenced, in one pass over
+    // the store. Returns the number of removed photos.
+    static int collectGarbage(const QSet<QString>& key_list) {
+        int count = 0;
+        QDirIterator it(getRoot(), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            if (key_list.contains(it.fileName())) {
+                continue;
+            }
+            // Read-only files can't be removed on Windows
+            QFile::setPermissions(
+                it.filePath(), QFile::ReadOwner | QFile::WriteOwner);
+            if (QFile::remove(it.filePath())) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+private:
+    static QString hashFile(const QString& filename) {
+        QFile file(filename);
+        if (!file.open(QFile::ReadOnly)) {
+            return QString();
+        }
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        if (!hash.addData(&file)) {
+            return QString();
+        }
+        return QString::fromLatin1(hash.result().toHex());
+    }
+
+    // A reflink shares the data until either file is modified
+    static bool clone(const QString& source, const QString& target) {
+#if defined(Q_OS_LINUX)
+        QByteArray sourcePath = QFile::encodeName(source);
+        QByteArray targetPath = QFile::encodeName(target);
+        int input = ::open(sourcePath.constData(), O_RDONLY);
+        if (input < 0) {
+            return false;
+        }
+        int output = ::open(
+            targetPath.constData(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (output < 0) {
+            ::close(input);
+            return false;
+        }
+
+        bool ok = ::ioctl(output, FICLONE, input) == 0;
+        ::close(output);
+        ::close(input);
+        if (!ok) {
+            ::unlink(targetPath.constData());
+        }
+        return ok;
+#else
+        Q_UNUSED(source);
+        Q_UNUSED(target);
+        return false;
+#endif
+    }
+};
+
+#endif // PHOTOSTORE_H
@@ -0,0 +1,206 @@
+#include "photostrip.h"
+
+#include <QFileInfo>
+#include <QImageReader>
+#include <QScrollBar>
+
+#include "photocache.h"
+#include "trace.h"
+
+// Public Methods
+
+PhotoStripModel::PhotoStripModel(QObject *parent)
+        : QAbstractListModel{parent}, m_generation(0),
+          m_thumbnails(MAX_CACHED_THUMBNAILS) {
+    m_pool.setMaxThreadCount(2);
+}
+
+PhotoStripModel::~PhotoStripModel() {
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+int PhotoStripModel::rowCount(const QModelIndex& parent) const {
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_photos.size() + 1;
+}
+
+QVariant PhotoStripModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    if (index.row() == m_photos.size()) {
+        if (role == Qt::DisplayRole) {
+            return "Add Photos";
+        }
+        return QVariant();
+    }
+
+    const QString& filename = m_photos[index.row()];
+    if (role == Qt::ToolTipRole) {
+        return QFileInfo(filename).fileName();
+    }
+    if (role == Qt::DecorationRole) {
+        QPixmap* thumbnail = m_thumbnails.object(filename);
+        if (thumbnail != nullptr) {
+            return *thumbnail;
+        }
+        request(filename);
+    }
+    return QVariant();
+}
+
+const QStringList& PhotoStripModel::getPhotos() const {
+    return m_photos;
+}
+
+// Pending decodes of the previous photos are dropped
+void PhotoStripModel::setPhotos(const QStringList& photos) {
+    beginResetModel();
+    m_photos = photos;
+    ++m_generation;
+    m_pool.clear();
+    m_pending.clear();
+    endResetModel();
+}
+
+void PhotoStripModel::addPhotos(const QStringList& photos) {
+    if (photos.isEmpty()) {
+        return;
+    }
+    int first = m_photos.size();
+    beginInsertRows(QModelIndex(), first, first + photos.size() - 1);
+    m_photos += photos;
+    endInsertRows();
+}
+
+void PhotoStripModel::removePhoto(int row) {
+    Q_ASSERT(row >= 0 && row < m_photos.size());
+    beginRemoveRows(QModelIndex(), row, row);
+    m_photos.removeAt(row);
+    endRemoveRows();
+}
+
+// Private Methods
+
+// Decodes the thumbnail on the pool, the result is delivered back to the
+// model on its thread
+void PhotoStripModel::request(const QString& filename) const {
+    if (m_pending.contains(filename)) {
+        return;
+    }
+    m_pending.insert(filename);
+
+    auto model = const_cast<PhotoStripModel*>(this);
+    int generation = m_generation;
+    m_pool.start([model, filename, generation]() {
+        TRACE_SCOPE("PhotoStripModel::decode");
+
+        QSize size(ICON_SIZE, ICON_SIZE);
+        QImageReader reader(PhotoCache::find(filename, size));
+        QSize imageSize = reader.size();
+        if (imageSize.isValid()) {
+            reader.setScaledSize(imageSize.scaled(size, Qt::KeepAspectRatio));
+        }
+        QImage image = reader.read();
+
+        QMetaObject::invokeMethod(
+            model, [model, filename, generation, image]() {
+                model->decoded(filename, generation, image);
+            }, Qt::QueuedConnection);
+    });
+}
+
+void PhotoStripModel::decoded(
+        const QString& filename, int generation, const QImage& image) {
+    if (generation != m_generation) {
+        return;
+    }
+    m_pending.remove(filename);
+
+    // A photo that can't be decoded gets an empty thumbnail
+    m_thumbnails.insert(filename, new QPixmap(QPixmap::fromImage(image)));
+    for (int row = 0; row < m_photos.size(); ++row) {
+        if (m_photos[row] == filename) {
+            QModelIndex index = this->index(row);
+            emit dataChanged(index, index, {Qt::DecorationRole});
+        }
+    }
+}
+
+// Public Methods
+
+PhotoStrip::PhotoStrip(QWidget *parent)
+        : QListView{parent}, m_model(new PhotoStripModel(this)) {
+    int size = PhotoStripModel::ICON_SIZE;
+    setModel(m_model);
+    setViewMode(IconMode);
+    setFlow(LeftToRight);
+    setWrapping(false);
+    setMovement(Static);
+    setUniformItemSizes(true);
+    setIconSize(QSize(size, size));
+    setGridSize(QSize(size + 8, size + 8));
+    setHorizontalScrollMode(ScrollPerPixel);
+    setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setSelectionMode(SingleSelection);
+    setFixedHeight(size + 8 + 2 * frameWidth() +
+                   horizontalScrollBar()->sizeHint().height());
+
+    QObject::connect(
+        this, &QListView::clicked,
+        this, &PhotoStrip::clicked);
+}
+
+QStringList PhotoStrip::getPhotos() const {
+    return m_model->getPhotos();
+}
+
+void PhotoStrip::setPhotos(const QStringList& photos) {
+    m_model->setPhotos(photos);
+    select(photos.isEmpty() ? -1 : 0);
+}
+
+// Selects the first of the added photos
+void PhotoStrip::addPhotos(const QStringList& photos) {
+    int first = m_model->getPhotos().size();
+    m_model->addPhotos(photos);
+    if (!photos.isEmpty()) {
+        select(first);
+    }
+}
+
+// Selects the photo that takes the place of the removed one
+void PhotoStrip::removePhoto(const QString& photo) {
+    int row = m_model->getPhotos().indexOf(photo);
+    if (row < 0) {
+        return;
+    }
+    m_model->removePhoto(row);
+    select(qMin(row, m_model->getPhotos().size() - 1));
+}
+
+// Private Methods
+
+void PhotoStrip::select(int row) {
+    if (row < 0) {
+        clearSelection();
+        return;
+    }
+
+    QModelIndex index = m_model->index(row);
+    setCurrentIndex(index);
+    scrollTo(index);
+    emit photoSelected(m_model->getPhotos()[row]);
+}
+
+void PhotoStrip::clicked(const QModelIndex& index) {
+    if (index.row() == m_model->getPhotos().size()) {
+        emit addRequested();
+    } else {
+        select(index.row());
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef PHOTOSTRIP_H
+#define PHOTOSTRIP_H
+
+#include <QAbstractListModel>
+#include <QCache>
+#include <QListView>
+#include <QPixmap>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+
+// Photo files of a strip, the last row adds photos. Thumbnails are only
+// decoded when the view asks for them, i.e. for visible rows, and a
+// bounded number of them is kept, so the least recently shown ones are
+// dropped.
+class PhotoStripModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    static constexpr int ICON_SIZE = 96;
+
+    explicit PhotoStripModel(QObject *parent = nullptr);
+    ~PhotoStripModel();
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role) const override;
+
+    const QStringList& getPhotos() const;
+    void setPhotos(const QStringList& photos);
+    void addPhotos(const QStringList& photos);
+    void removePhoto(int row);
+
+private:
+    void request(const QString& filename) const;
+    void decoded(const QString& filename, int generation, const QImage& image);
+
+private:
+    static constexpr int MAX_CACHED_THUMBNAILS = 256;
+
+    QStringList m_photos;
+    int m_generation; // Bumped when the photos are replaced
+
+    // Filled lazily from data()
+    mutable QCache<QString, QPixmap> m_thumbnails;
+    mutable QSet<QString> m_pending;
+    mutable QThreadPool m_pool;
+};
+
+// Horizontal strip of photo thumbnails under the photo view
+class PhotoStrip : public QListView {
+    Q_OBJECT
+public:
+    explicit PhotoStrip(QWidget *parent = nullptr);
+
+    QStringList getPhotos() const;
+    void setPhotos(const QStringList& photos);
+    void addPhotos(const QStringList& photos);
+    void removePhoto(const QString& photo);
+
+signals:
+    void photoSelected(const QString& photo);
+    void addRequested();
+
+private:
+    void select(int row);
+    void clicked(const QModelIndex& index);
+
+private:
+    PhotoStripModel* m_model;
+};
+
+#endif // PHOTOSTRIP_H
@@ -1,12 +1,18 @@
 #include "photoview.h"
 
 #include <QFileDialog>
+#include <QFutureWatcher>
 #include <QGraphicsTextItem>
+#include <QImageReader>
 #include <QMouseEvent>
+#include <QtConcurrent>
+
+#include "photocache.h"
+#include "trace.h"
 
 // Public Methods
 
-PhotoView::PhotoView() {
+PhotoView::PhotoView() : m_generation(new QAtomicInt(0)) {
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     auto scene = new QGraphicsScene(this);
@@ -15,60 +21,104 @@ PhotoView::PhotoView() {
 }
 
 void PhotoView::enable() {
-    auto scene = this->scene();
-    Q_ASSERT(scene != nullptr);
-    scene->clear();
-    scene->setSceneRect(QRectF());
-    scene->addText("Add Photo");
+    m_generation->ref();
+    showText("Add Photos", QColorConstants::Black);
     setEnabled(true);
 }
 
 void PhotoView::disable() {
-    auto scene = this->scene();
-    Q_ASSERT(scene != nullptr);
-    scene->clear();
-    scene->setSceneRect(QRectF());
-    scene->setBackgroundBrush(QPalette().window());
-    scene->addText("Add Photo")->setDefaultTextColor(QColorConstants::Gray);
+    m_generation->ref();
+    showText("Add Photos", QColorConstants::Gray);
+    scene()->setBackgroundBrush(QPalette().window());
     setEnabled(false);
     m_filename = "";
 }
 
+// Decodes the photo in background right at the size of the view,
+// showing a placeholder until it is ready
 void PhotoView::load(const QString& filename) {
     Q_ASSERT(!filename.isEmpty());
+    TRACE_SCOPE("PhotoView::load");
 
     if (QFileInfo::exists(filename)) {
         m_filename = filename;
-        QImage image(m_filename);
-        image = image.scaled(
-                    this->size(),
-                    Qt::KeepAspectRatio,
-                    Qt::SmoothTransformation);
-        auto scene = this->scene();
-        Q_ASSERT(scene != nullptr);
-        scene->clear();
-        scene->setSceneRect(QRectF(QPointF(0, 0), image.size()));
-        scene->addPixmap(QPixmap::fromImage(image));
+        int generation = m_generation->fetchAndAddOrdered(1) + 1;
+        showText("Loading...", QColorConstants::Gray);
+
+        auto watcher = new QFutureWatcher<QImage>(this);
+        QObject::connect(
+            watcher, &QFutureWatcher<QImage>::finished,
+            this, [this, watcher, generation]() {
+                watcher->deleteLater();
+                QImage image = watcher->result();
+                if (generation != m_generation->loadAcquire() ||
+                        image.isNull()) {
+                    return;
+                }
+
+                auto scene = this->scene();
+                Q_ASSERT(scene != nullptr);
+                scene->clear();
+                scene->setSceneRect(QRectF(QPointF(0, 0), image.size()));
+                scene->addPixmap(QPixmap::fromImage(image));
+            });
+
+        QSize size = this->size();
+        QSharedPointer<QAtomicInt> current = m_generation;
+        watcher->setFuture(QtConcurrent::run(
+            [filename, size, current, generation]() {
+                if (generation != current->loadAcquire()) {
+                    return QImage();
+                }
+
+                TRACE_SCOPE("PhotoView::load decode");
+
+                // Lets the decoder downscale, e.g. JPEG in the DCT domain
+                QImageReader reader(PhotoCache::find(filename, size));
+                QSize imageSize = reader.size();
+                if (imageSize.isValid()) {
+                    reader.setScaledSize(
+                        imageSize.scaled(size, Qt::KeepAspectRatio));
+                }
+                return reader.read();
+            }));
     }
 }
 
+void PhotoView::selectPhotos() {
+    QFileDialog dialog(this);
+    dialog.setWindowTitle("Open JPEG Image Files");
+    dialog.setFileMode(QFileDialog::ExistingFiles);
+    dialog.setNameFilter(tr("Images (*.jpg *.jpeg)"));
+    if (dialog.exec()) {
+        auto fileList = dialog.selectedFiles();
+        if (!fileList.isEmpty()) {
+            emit photosAdded(fileList);
+        }
+    }
+}
+
+// Private Methods
+
+void PhotoView::showText(const QString& text, const QColor& color) {
+    auto scene = this->scene();
+    Q_ASSERT(scene != nullptr);
+    scene->clear();
+    scene->setSceneRect(QRectF());
+    scene->addText(text)->setDefaultTextColor(color);
+}
+
 // Protected Methods
 
 void PhotoView::mousePressEvent(QMouseEvent *event) {
     if (event->button() == Qt::LeftButton) {
         if (m_filename.isEmpty()) {
-            QFileDialog dialog(this);
-            dialog.setWindowTitle("Open JPEG Image File");
-            dialog.setNameFilter(tr("Images (*.jpg *.jpeg)"));
-            if (dialog.exec()) {
-                auto fileList = dialog.selectedFiles();
-                if (!fileList.isEmpty()) {
-                    load(fileList.front());
-                }
-            }
+            selectPhotos();
         } else {
+            QString filename = m_filename;
             m_filename = "";
             enable();
+            emit photoRemoved(filename);
         }
     }
 
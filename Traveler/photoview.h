@@ -1,7 +1,9 @@
 #ifndef PHOTOVIEW_H
 #define PHOTOVIEW_H
 
+#include <QAtomicInt>
 #include <QGraphicsView>
+#include <QSharedPointer>
 
 class PhotoView : public QGraphicsView
 {
@@ -11,16 +13,28 @@ public:
     void enable();
     void disable();
     void load(const QString& filename);
+    void selectPhotos();
 
     QString filename() {
         return m_filename;
     }
 
+signals:
+    void photosAdded(const QStringList& filenames);
+    void photoRemoved(const QString& filename);
+
 protected:
     void mousePressEvent(QMouseEvent *event) override;
 
+private:
+    void showText(const QString& text, const QColor& color);
+
 private:
     QString m_filename;
+
+    // Bumped on every request, shared with the decoding tasks so that
+    // stale ones are skipped or dropped
+    QSharedPointer<QAtomicInt> m_generation;
 };
 
 #endif // PHOTOVIEW_H
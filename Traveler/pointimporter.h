@@ -0,0 +1,207 @@
+#ifndef POINTIMPORTER_H
+#define POINTIMPORTER_H
+
+#include <QFile>
+#include <QFileInfo>
+#include <QPointF>
+#include <QRectF>
+#include <QSize>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <QXmlStreamReader>
+
+// Reads points from CSV files with "x,y,name" or "lat,lon,name" columns
+// and from GPX waypoints. Geographic coordinates are mapped onto the map
+// through its bounds, see MapFile::readBounds.
+class PointImporter {
+public:
+    struct Point {
+        QPointF point; // Map coordinates, or longitude and latitude
+        QString name;
+    };
+
+    static bool read(
+            const QString& filename,
+            QVector<Point>& point_list,
+            bool& geographic,
+            QString& error) {
+        QFile file(filename);
+        if (!file.open(QFile::ReadOnly | QFile::Text)) {
+            error = "Unable to open " + filename;
+            return false;
+        }
+
+        if (QFileInfo(filename).suffix().compare("gpx", Qt::CaseInsensitive) == 0) {
+            geographic = true;
+            return readGpx(file, point_list, error);
+        }
+        return readCsv(file, point_list, geographic, error);
+    }
+
+    // Linear mapping of the bounds, which hold longitudes horizontally and
+    // latitudes vertically, onto the map
+    static void georeference(
+            QVector<Point>& point_list,
+            const QRectF& bounds, QSize size) {
+        Q_ASSERT(bounds.width() != 0 && bounds.height() != 0);
+        for (Point& point : point_list) {
+            qreal lon = point.point.x();
+            qreal lat = point.point.y();
+            point.point = QPointF(
+                (lon - bounds.left()) / bounds.width() * size.width(),
+                (bounds.bottom() - lat) / bounds.height() * size.height());
+        }
+    }
+
+private:
+    // The header is optional, without it the columns are x, y and name
+    static bool readCsv(
+            QFile& file,
+            QVector<Point>& point_list,
+            bool& geographic,
+            QString& error) {
+        QTextStream stream(&file);
+        int x_column = 0, y_column = 1, name_column = 2;
+        geographic = false;
+
+        int line_number = 0;
+        QString line;
+        while (stream.readLineInto(&line)) {
+            ++line_number;
+            if (line.trimmed().isEmpty()) {
+                continue;
+            }
+
+            QStringList field_list = splitCsv(line);
+            if (line_number == 1 && readHeader(
+                    field_list, x_column, y_column, name_column, geographic)) {
+                continue;
+            }
+
+            bool ok_x = false, ok_y = false;
+            Point point;
+            if (x_column < field_list.size() && y_column < field_list.size()) {
+                point.point = QPointF(
+                    field_list[x_column].trimmed().toDouble(&ok_x),
+                    field_list[y_column].trimmed().toDouble(&ok_y));
+            }
+            if (!ok_x || !ok_y) {
+                error = QString("Invalid coordinates on line %1").arg(line_number);
+                return false;
+            }
+            if (name_column < field_list.size()) {
+                point.name = field_list[name_column].trimmed();
+            }
+            point_list.push_back(point);
+        }
+        return true;
+    }
+
+    static bool readHeader(
+            const QStringList& field_list,
+            int& x_column, int& y_column, int& name_column,
+            bool& geographic) {
+        int x = -1, y = -1, lat = -1, lon = -1, name = -1;
+        for (int i = 0; i < field_list.size(); ++i) {
+            QString field = field_list[i].trimmed().toLower();
+            if (field == "x") {
+                x = i;
+            } else if (field == "y") {
+                y = i;
+            } else if (field == "lat" || field == "latitude") {
+                lat = i;
+            } else if (field == "lon" || field == "lng" || field == "longitude") {
+                lon = i;
+            } else if (field == "name") {
+                name = i;
+            }
+        }
+
+        if (lat >= 0 && lon >= 0) {
+            x_column = lon;
+            y_column = lat;
+            geographic = true;
+        } else if (x >= 0 && y >= 0) {
+            x_column = x;
+            y_column = y;
+        } else {
+            return false;
+        }
+        name_column = name >= 0 ? name : field_list.size();
+        return true;
+    }
+
+    // Fields may be quoted, with doubled quotes inside
+    static QStringList splitCsv(const QString& line) {
+        QStringList field_list;
+        QString field;
+        bool quoted = false;
+        for (int i = 0; i < line.size(); ++i) {
+            QChar c = line[i];
+            if (quoted) {
+                if (c == u'"' && i + 1 < line.size() && line[i + 1] == u'"') {
+                    field += c;
+                    ++i;
+                } else if (c == u'"') {
+                    quoted = false;
+                } else {
+                    field += c;
+                }
+            } else if (c == u'"') {
+                quoted = true;
+            } else if (c == u',') {
+                field_list.push_back(field);
+                field.clear();
+            } else {
+                field += c;
+            }
+        }
+        field_list.push_back(field);
+        return field_list;
+    }
+
+    static bool readGpx(
+            QFile& file,
+            QVector<Point>& point_list,
+            QString& error) {
+        QXmlStreamReader reader(&file);
+        while (!reader.atEnd()) {
+            if (!reader.readNextStartElement()) {
+                continue;
+            }
+            if (reader.name() != u"wpt") {
+                continue;
+            }
+
+            auto attributes = reader.attributes();
+            bool ok_lat = false, ok_lon = false;
+            Point point;
+            point.point = QPointF(
+                attributes.value("lon").toDouble(&ok_lon),
+                attributes.value("lat").toDouble(&ok_lat));
+            if (!ok_lat || !ok_lon) {
+                error = QString("Invalid waypoint on line %1")
+                    .arg(reader.lineNumber());
+                return false;
+            }
+
+            while (reader.readNextStartElement()) {
+                if (reader.name() == u"name") {
+                    point.name = reader.readElementText().trimmed();
+                } else {
+                    reader.skipCurrentElement();
+                }
+            }
+            point_list.push_back(point);
+        }
+
+        if (reader.hasError()) {
+            error = reader.errorString();
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif // POINTIMPORTER_H
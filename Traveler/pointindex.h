@@ -0,0 +1,98 @@
+#ifndef POINTINDEX_H
+#define POINTINDEX_H
+
+#include "mappoint.h"
+
+#include <QHash>
+#include <QPointF>
+#include <QVector>
+
+#include <cmath>
+
+// Uniform grid over point positions. Cells are keyed by their integer
+// coordinates, so only occupied cells take memory and inserts/removes
+// touch a single cell.
+class PointIndex {
+public:
+    void reset(float cellSize) {
+        Q_ASSERT(cellSize > 0.0f);
+        m_cellSize = cellSize;
+        m_cells.clear();
+    }
+
+    void insert(int id, QPointF point) {
+        m_cells[key(point)].push_back(id);
+    }
+
+    void remove(int id, QPointF point) {
+        auto cell = m_cells.find(key(point));
+        Q_ASSERT(cell != m_cells.end());
+        bool ok = cell->removeOne(id);
+        Q_ASSERT(ok);
+        if (cell->isEmpty()) {
+            m_cells.erase(cell);
+        }
+    }
+
+    // Renumbers a point, e.g. after it was moved within the point list
+    void move(int from, int to, QPointF point) {
+        auto cell = m_cells.find(key(point));
+        Q_ASSERT(cell != m_cells.end());
+        int i = cell->indexOf(from);
+        Q_ASSERT(i >= 0);
+        (*cell)[i] = to;
+    }
+
+    // Returns the index of the point nearest to the query within radius,
+    // or -1
+    int findNearest(
+            const QVector<MapPoint>& point_list,
+            QPointF point, float radius) const {
+        int x0 = cell(point.x() - radius);
+        int x1 = cell(point.x() + radius);
+        int y0 = cell(point.y() - radius);
+        int y1 = cell(point.y() + radius);
+
+        int result = -1;
+        float best = radius * radius;
+        for (int x = x0; x <= x1; ++x) {
+            for (int y = y0; y <= y1; ++y) {
+                auto it = m_cells.constFind(key(x, y));
+                if (it == m_cells.constEnd()) {
+                    continue;
+                }
+                for (int id : *it) {
+                    const QPointF& p = point_list[id].getPoint();
+                    float dx = p.x() - point.x();
+                    float dy = p.y() - point.y();
+                    float distance = dx * dx + dy * dy;
+                    if (distance < best ||
+                            (distance == best && result < 0)) {
+                        best = distance;
+                        result = id;
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+private:
+    int cell(qreal value) const {
+        return static_cast<int>(std::floor(value / m_cellSize));
+    }
+
+    static quint64 key(int x, int y) {
+        return (quint64(quint32(x)) << 32) | quint32(y);
+    }
+
+    quint64 key(QPointF point) const {
+        return key(cell(point.x()), cell(point.y()));
+    }
+
+private:
+    float m_cellSize = 1.0f;
+    QHash<quint64, QVector<int>> m_cells;
+};
+
+#endif // POINTINDEX_H
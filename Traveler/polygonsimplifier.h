@@ -0,0 +1,91 @@
+#ifndef POLYGONSIMPLIFIER_H
+#define POLYGONSIMPLIFIER_H
+
+#include <QPair>
+#include <QPolygonF>
+#include <QVarLengthArray>
+#include <QVector>
+
+// Douglas-Peucker simplification of closed polygons
+class PolygonSimplifier {
+public:
+    // Drops vertices closer than the tolerance to the simplified outline.
+    // The ring is split at its first vertex and the vertex farthest from
+    // it, and both halves are simplified as polylines.
+    static QPolygonF simplify(const QPolygonF& polygon, qreal tolerance) {
+        int size = polygon.size();
+        if (size <= 3 || tolerance <= 0.0) {
+            return polygon;
+        }
+
+        int farthest = 0;
+        qreal best = -1.0;
+        for (int i = 1; i < size; ++i) {
+            QPointF d = polygon[i] - polygon[0];
+            qreal distance = d.x() * d.x() + d.y() * d.y();
+            if (distance > best) {
+                best = distance;
+                farthest = i;
+            }
+        }
+
+        QVector<bool> keep(size + 1, false);
+        keep[0] = true;
+        keep[farthest] = true;
+        keep[size] = true;
+        mark(polygon, 0, farthest, tolerance * tolerance, keep);
+        mark(polygon, farthest, size, tolerance * tolerance, keep);
+
+        QPolygonF result;
+        for (int i = 0; i < size; ++i) {
+            if (keep[i]) {
+                result.push_back(polygon[i]);
+            }
+        }
+        return result;
+    }
+
+private:
+    // Index size stands for the first vertex closing the ring
+    static void mark(
+            const QPolygonF& polygon, int first, int last,
+            qreal tolerance2, QVector<bool>& keep) {
+        int size = polygon.size();
+        QVarLengthArray<QPair<int, int>, 64> stack;
+        stack.push_back(qMakePair(first, last));
+        while (!stack.isEmpty()) {
+            auto range = stack.back();
+            stack.pop_back();
+
+            QPointF a = polygon[range.first];
+            QPointF b = polygon[range.second % size];
+            QPointF ab = b - a;
+            qreal length2 = ab.x() * ab.x() + ab.y() * ab.y();
+
+            int index = -1;
+            qreal best = tolerance2;
+            for (int i = range.first + 1; i < range.second; ++i) {
+                QPointF ap = polygon[i] - a;
+                qreal distance2 = 0.0;
+                if (length2 > 0.0) {
+                    qreal cross = ab.x() * ap.y() - ab.y() * ap.x();
+                    distance2 = cross * cross / length2;
+                } else {
+                    distance2 = ap.x() * ap.x() + ap.y() * ap.y();
+                }
+                if (distance2 > best) {
+                    best = distance2;
+                    index = i;
+                }
+            }
+
+            if (index >= 0) {
+                keep[index] = true;
+                stack.push_back(qMakePair(range.first, index));
+                stack.push_back(qMakePair(index, range.second));
+            }
+        }
+    }
+};
+
+#endif // POLYGONSIMPLIFIER_H
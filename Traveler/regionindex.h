@@ -0,0 +1,135 @@
+#ifndef REGIONINDEX_H
+#define REGIONINDEX_H
+
+#include "mapregion.h"
+
+#include <QPointF>
+#include <QRectF>
+#include <QVarLengthArray>
+#include <QVector>
+
+#include <algorithm>
+
+// Bounding volume hierarchy over the polygons of all regions.
+// Built once after load, it narrows a point query down to the few
+// polygons whose bounding boxes contain the point.
+class RegionIndex {
+public:
+    void build(const QVector<MapRegion>& region_list) {
+        m_items.clear();
+        m_nodes.clear();
+
+        for (int i = 0; i < region_list.size(); ++i) {
+            const auto& polygon_list = region_list[i].getPolygonList();
+            for (int j = 0; j < polygon_list.size(); ++j) {
+                m_items.push_back({polygon_list[j].boundingRect(), i, j});
+            }
+        }
+
+        if (!m_items.isEmpty()) {
+            m_nodes.reserve(2 * m_items.size() / LEAF_SIZE + 1);
+            m_nodes.resize(1);
+            buildNode(0, 0, m_items.size());
+        }
+    }
+
+    // Returns the index of the first region (in document order)
+    // containing the point, or -1
+    int find(const QVector<MapRegion>& region_list, QPointF point) const {
+        if (m_nodes.isEmpty()) {
+            return -1;
+        }
+
+        QVarLengthArray<const Item*, 16> candidates;
+        QVarLengthArray<int, 64> stack;
+        stack.push_back(0);
+        while (!stack.isEmpty()) {
+            const Node& node = m_nodes[stack.back()];
+            stack.pop_back();
+            if (!node.box.contains(point)) {
+                continue;
+            }
+            if (node.count > 0) {
+                for (int i = node.first; i < node.first + node.count; ++i) {
+                    if (m_items[i].box.contains(point)) {
+                        candidates.push_back(&m_items[i]);
+                    }
+                }
+            } else {
+                stack.push_back(node.first);
+                stack.push_back(node.first + 1);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Item* a, const Item* b) {
+            return a->region < b->region;
+        });
+
+        for (const Item* item : candidates) {
+            const QPolygonF& polygon =
+                region_list[item->region].getPolygonList()[item->polygon];
+            if (polygon.containsPoint(point, Qt::OddEvenFill)) {
+                return item->region;
+            }
+        }
+        return -1;
+    }
+
+private:
+    static constexpr int LEAF_SIZE = 4;
+
+    struct Item {
+        QRectF box;
+        int region;
+        int polygon;
+    };
+
+    // Leaves have count > 0 and reference m_items[first, first + count).
+    // Inner nodes have count == 0 and children at first and first + 1.
+    struct Node {
+        QRectF box;
+        int first;
+        int count;
+    };
+
+    void buildNode(int id, int begin, int end) {
+        QRectF box = m_items[begin].box;
+        for (int i = begin + 1; i < end; ++i) {
+            box |= m_items[i].box;
+        }
+
+        m_nodes[id] = {box, begin, end - begin};
+        if (end - begin <= LEAF_SIZE) {
+            return;
+        }
+
+        // Split at the median of the box centers along the longest axis
+        bool by_x = box.width() >= box.height();
+        int middle = begin + (end - begin) / 2;
+        std::nth_element(
+            m_items.begin() + begin,
+            m_items.begin() + middle,
+            m_items.begin() + end,
+            [by_x](const Item& a, const Item& b) {
+                return by_x ?
+                    a.box.center().x() < b.box.center().x() :
+                    a.box.center().y() < b.box.center().y();
+            });
+
+        // Children are allocated as an adjacent pair
+        int left = m_nodes.size();
+        m_nodes.resize(left + 2);
+        m_nodes[id].first = left;
+        m_nodes[id].count = 0;
+
+        buildNode(left, begin, middle);
+        buildNode(left + 1, middle, end);
+    }
+
+private:
+    QVector<Item> m_items;
+    QVector<Node> m_nodes;
+};
+
+#endif // REGIONINDEX_H
@@ -0,0 +1,141 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <QVector>
+
+#include <utility>
+
+// Values stored densely in insertion order, addressed by handles that
+// stay valid until the value is removed. A handle pairs a slot with the
+// generation of the slot, which is bumped on removal, so handles of
+// removed values are recognized as stale. Insert, lookup and remove are
+// O(1), removal moves the last value in place of the removed one.
+template <typename T>
+class SlotMap {
+public:
+    struct Handle {
+        int slot = -1;
+        quint32 generation = 0;
+
+        bool isNull() const {
+            return slot < 0;
+        }
+
+        bool operator==(const Handle& right) const {
+            return slot == right.slot && generation == right.generation;
+        }
+
+        bool operator!=(const Handle& right) const {
+            return !(*this == right);
+        }
+    };
+
+    void reserve(int size) {
+        m_values.reserve(size);
+        m_valueSlots.reserve(size);
+        m_slots.reserve(size);
+    }
+
+    void clear() {
+        m_values.clear();
+        m_valueSlots.clear();
+        m_slots.clear();
+        m_freeSlots.clear();
+    }
+
+    int size() const {
+        return m_values.size();
+    }
+
+    // Values in dense order
+    const QVector<T>& getValues() const {
+        return m_values;
+    }
+
+    Handle insert(T value) {
+        int slot;
+        if (!m_freeSlots.isEmpty()) {
+            slot = m_freeSlots.takeLast();
+        } else {
+            slot = m_slots.size();
+            m_slots.push_back({-1, 0});
+        }
+
+        m_slots[slot].index = m_values.size();
+        m_values.push_back(std::move(value));
+        m_valueSlots.push_back(slot);
+        return {slot, m_slots[slot].generation};
+    }
+
+    // Returns the dense index of the value, or -1 for a stale handle
+    int indexOf(const Handle& handle) const {
+        if (handle.slot < 0 || handle.slot >= m_slots.size()) {
+            return -1;
+        }
+        const Slot& slot = m_slots[handle.slot];
+        return slot.generation == handle.generation ? slot.index : -1;
+    }
+
+    bool contains(const Handle& handle) const {
+        return indexOf(handle) >= 0;
+    }
+
+    T& operator[](int index) {
+        return m_values[index];
+    }
+
+    const T& operator[](int index) const {
+        return m_values[index];
+    }
+
+    Handle getHandle(int index) const {
+        Q_ASSERT(index >= 0 && index < m_values.size());
+        int slot = m_valueSlots[index];
+        return {slot, m_slots[slot].generation};
+    }
+
+    T* get(const Handle& handle) {
+        int index = indexOf(handle);
+        return index >= 0 ? &m_values[index] : nullptr;
+    }
+
+    const T* get(const Handle& handle) const {
+        int index = indexOf(handle);
+        return index >= 0 ? &m_values[index] : nullptr;
+    }
+
+    bool remove(const Handle& handle) {
+        int index = indexOf(handle);
+        if (index < 0) {
+            return false;
+        }
+
+        int last = m_values.size() - 1;
+        if (index != last) {
+            m_values[index] = std::move(m_values[last]);
+            m_valueSlots[index] = m_valueSlots[last];
+            m_slots[m_valueSlots[index]].index = index;
+        }
+        m_values.pop_back();
+        m_valueSlots.pop_back();
+
+        Slot& slot = m_slots[handle.slot];
+        slot.index = -1;
+        ++slot.generation;
+        m_freeSlots.push_back(handle.slot);
+        return true;
+    }
+
+private:
+    struct Slot {
+        int index; // Into the values, -1 for a free slot
+        quint32 generation;
+    };
+
+    QVector<T> m_values;
+    QVector<int> m_valueSlots; // Follows the values
+    QVector<Slot> m_slots;
+    QVector<int> m_freeSlots;
+};
+
+#endif // SLOTMAP_H
@@ -0,0 +1,126 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+
+#include <atomic>
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Times the rest of the enclosing scope. The name has to be a literal.
+#define TRACE_SCOPE(name) \
+    Trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+// Collects timing spans and writes them as Chrome trace-event JSON, which
+// can be opened in chrome://tracing or Perfetto. Tracing is off unless
+// started, a disabled span costs a single atomic load.
+class Trace {
+public:
+    static constexpr const char* ENVIRONMENT_VARIABLE = "TRAVELER_TRACE";
+
+    class Scope {
+    public:
+        explicit Scope(const char* name)
+                : m_name(isEnabled() ? name : nullptr),
+                  m_start(m_name != nullptr ? now() : 0) {}
+
+        ~Scope() {
+            if (m_name != nullptr) {
+                record(m_name, m_start, now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name;
+        qint64 m_start;
+    };
+
+    static bool isEnabled() {
+        return s_enabled.load(std::memory_order_acquire);
+    }
+
+    // Spans are kept in memory until the trace is stopped
+    static void start(const QString& filename) {
+        Q_ASSERT(!filename.isEmpty());
+
+        QMutexLocker locker(&s_mutex);
+        s_filename = filename;
+        s_events.clear();
+        s_timer.start();
+        s_enabled.store(true, std::memory_order_release);
+    }
+
+    static bool stop() {
+        if (!isEnabled()) {
+            return true;
+        }
+        s_enabled.store(false, std::memory_order_release);
+
+        QMutexLocker locker(&s_mutex);
+        qint64 pid = QCoreApplication::applicationPid();
+        QJsonArray event_list;
+        for (const Event& event : qAsConst(s_events)) {
+            event_list.append(QJsonObject{
+                {"name", QLatin1String(event.name)},
+                {"cat", "traveler"},
+                {"ph", "X"},
+                {"ts", event.start / 1000.0},
+                {"dur", (event.end - event.start) / 1000.0},
+                {"pid", pid},
+                {"tid", qint64(event.thread)}
+            });
+        }
+        s_events.clear();
+
+        QFile file(s_filename);
+        if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+            return false;
+        }
+        QJsonObject root{
+            {"traceEvents", event_list},
+            {"displayTimeUnit", "ms"}
+        };
+        return file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) >= 0;
+    }
+
+private:
+    struct Event {
+        const char* name;
+        quintptr thread;
+        qint64 start; // In nanoseconds since the trace was started
+        qint64 end;
+    };
+
+    static qint64 now() {
+        return s_timer.nsecsElapsed();
+    }
+
+    static void record(const char* name, qint64 start, qint64 end) {
+        quintptr thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+        QMutexLocker locker(&s_mutex);
+        if (isEnabled()) {
+            s_events.push_back({name, thread, start, end});
+        }
+    }
+
+private:
+    static inline std::atomic<bool> s_enabled{false};
+    static inline QMutex s_mutex;
+    static inline QElapsedTimer s_timer;
+    static inline QString s_filename;
+    static inline QVector<Event> s_events;
+};
+
+#endif // TRACE_H